@@ -0,0 +1,289 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVHAL project: https://github.com/nvitya/nvhal
+ * Copyright (c) 2020 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     crc.cpp
+ *  brief:    CRC16 / CRC32 calculation for serial framing
+ *  version:  1.00
+ *  date:     2026-10-19
+ *  authors:  nvitya
+ *  notes:
+ *    The portable implementation uses slicing-by-8 tables (8 bytes per step).
+ *    On ARMv8 the CRC32 instructions are used for the CRC32, when the CPU has them.
+*/
+
+#include "string.h"
+#include <pthread.h>
+#include "platform.h"
+#include "crc.h"
+
+#if defined(__aarch64__)
+  #include <arm_acle.h>
+  #include <sys/auxv.h>
+  #ifndef HWCAP_CRC32
+    #define HWCAP_CRC32  (1 << 7)
+  #endif
+  #define CRC32_HW_SUPPORT  1
+#else
+  #define CRC32_HW_SUPPORT  0
+#endif
+
+#define CRC_COPY_CHUNK  256
+
+static uint32_t  crc32_table[8][256];
+static uint16_t  crc16_modbus_table[8][256];
+static uint16_t  crc16_ccitt_table[256];
+static pthread_once_t  crc_tables_once = PTHREAD_ONCE_INIT;  // the tables are built by the first user thread
+
+static void crc_init_tables()
+{
+	for (unsigned i = 0; i < 256; ++i)
+	{
+		uint32_t c32 = i;
+		uint16_t c16 = i;
+		uint16_t cc = (i << 8);
+		for (unsigned b = 0; b < 8; ++b)
+		{
+			c32 = (c32 & 1 ? (c32 >> 1) ^ 0xEDB88320 : (c32 >> 1));
+			c16 = (c16 & 1 ? (c16 >> 1) ^ 0xA001 : (c16 >> 1));
+			cc  = (cc & 0x8000 ? (cc << 1) ^ 0x1021 : (cc << 1));
+		}
+		crc32_table[0][i] = c32;
+		crc16_modbus_table[0][i] = c16;
+		crc16_ccitt_table[i] = cc;
+	}
+
+	// table k: the effect of a byte followed by k zero bytes
+	for (unsigned k = 1; k < 8; ++k)
+	{
+		for (unsigned i = 0; i < 256; ++i)
+		{
+			uint32_t c32 = crc32_table[k - 1][i];
+			crc32_table[k][i] = (c32 >> 8) ^ crc32_table[0][c32 & 0xFF];
+			uint16_t c16 = crc16_modbus_table[k - 1][i];
+			crc16_modbus_table[k][i] = (c16 >> 8) ^ crc16_modbus_table[0][c16 & 0xFF];
+		}
+	}
+}
+
+static inline void crc_check_tables()
+{
+	pthread_once(&crc_tables_once, crc_init_tables);
+}
+
+//-----------------------------------------------------------------------------
+// CRC32
+
+#if CRC32_HW_SUPPORT
+
+static int crc32_hw_state = -1;  // -1 = not checked yet
+
+bool crc32_hw_available()
+{
+	int state = __atomic_load_n(&crc32_hw_state, __ATOMIC_RELAXED);
+	if (state < 0)
+	{
+		state = ((getauxval(AT_HWCAP) & HWCAP_CRC32) ? 1 : 0);
+		__atomic_store_n(&crc32_hw_state, state, __ATOMIC_RELAXED);  // the same value from any thread
+	}
+	return (state > 0);
+}
+
+__attribute__((target("+crc")))
+static uint32_t crc32_hw(uint32_t crc, const uint8_t * p, unsigned len)
+{
+	while (len && ((uintptr_t)p & 7))
+	{
+		crc = __crc32b(crc, *p++);
+		--len;
+	}
+
+	uint64_t v;
+	while (len >= 8)
+	{
+		memcpy(&v, p, 8);
+		crc = __crc32d(crc, v);
+		p += 8;
+		len -= 8;
+	}
+
+	while (len)
+	{
+		crc = __crc32b(crc, *p++);
+		--len;
+	}
+
+	return crc;
+}
+
+#else
+
+bool crc32_hw_available()
+{
+	return false;
+}
+
+#endif
+
+static uint32_t crc32_sw(uint32_t crc, const uint8_t * p, unsigned len)
+{
+	crc_check_tables();
+
+	while (len && ((uintptr_t)p & 3))
+	{
+		crc = crc32_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+		--len;
+	}
+
+	uint32_t w1, w2;
+	while (len >= 8)  // little endian
+	{
+		memcpy(&w1, p, 4);
+		memcpy(&w2, p + 4, 4);
+		w1 ^= crc;
+		crc = crc32_table[7][ w1        & 0xFF] ^ crc32_table[6][(w1 >>  8) & 0xFF]
+		    ^ crc32_table[5][(w1 >> 16) & 0xFF] ^ crc32_table[4][ w1 >> 24        ]
+		    ^ crc32_table[3][ w2        & 0xFF] ^ crc32_table[2][(w2 >>  8) & 0xFF]
+		    ^ crc32_table[1][(w2 >> 16) & 0xFF] ^ crc32_table[0][ w2 >> 24        ];
+		p += 8;
+		len -= 8;
+	}
+
+	while (len)
+	{
+		crc = crc32_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+		--len;
+	}
+
+	return crc;
+}
+
+uint32_t crc32_calc(uint32_t acrc, const void * adata, unsigned alen)
+{
+	uint32_t crc = ~acrc;
+
+#if CRC32_HW_SUPPORT
+	if (crc32_hw_available())
+	{
+		return ~crc32_hw(crc, (const uint8_t *)adata, alen);
+	}
+#endif
+
+	return ~crc32_sw(crc, (const uint8_t *)adata, alen);
+}
+
+uint32_t crc32_copy(uint32_t acrc, void * adst, const void * asrc, unsigned alen)
+{
+	// the source is processed in chunks that stay in the cache,
+	// the destination is written by bytes as it might be uncached memory
+	const uint8_t * src = (const uint8_t *)asrc;
+	uint8_t *       dst = (uint8_t *)adst;
+
+	while (alen)
+	{
+		unsigned n = (alen > CRC_COPY_CHUNK ? CRC_COPY_CHUNK : alen);
+		acrc = crc32_calc(acrc, src, n);
+		for (unsigned i = 0; i < n; ++i)
+		{
+			dst[i] = src[i];
+		}
+		src += n;
+		dst += n;
+		alen -= n;
+	}
+
+	return acrc;
+}
+
+//-----------------------------------------------------------------------------
+// CRC16
+
+uint16_t crc16_modbus(uint16_t acrc, const void * adata, unsigned alen)
+{
+	crc_check_tables();
+
+	const uint8_t * p = (const uint8_t *)adata;
+	uint32_t crc = acrc;
+
+	while (alen && ((uintptr_t)p & 3))
+	{
+		crc = crc16_modbus_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+		--alen;
+	}
+
+	uint32_t w1, w2;
+	while (alen >= 8)  // little endian
+	{
+		memcpy(&w1, p, 4);
+		memcpy(&w2, p + 4, 4);
+		w1 ^= crc;
+		crc = crc16_modbus_table[7][ w1        & 0xFF] ^ crc16_modbus_table[6][(w1 >>  8) & 0xFF]
+		    ^ crc16_modbus_table[5][(w1 >> 16) & 0xFF] ^ crc16_modbus_table[4][ w1 >> 24        ]
+		    ^ crc16_modbus_table[3][ w2        & 0xFF] ^ crc16_modbus_table[2][(w2 >>  8) & 0xFF]
+		    ^ crc16_modbus_table[1][(w2 >> 16) & 0xFF] ^ crc16_modbus_table[0][ w2 >> 24        ];
+		p += 8;
+		alen -= 8;
+	}
+
+	while (alen)
+	{
+		crc = crc16_modbus_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+		--alen;
+	}
+
+	return crc;
+}
+
+uint16_t crc16_modbus_copy(uint16_t acrc, void * adst, const void * asrc, unsigned alen)
+{
+	const uint8_t * src = (const uint8_t *)asrc;
+	uint8_t *       dst = (uint8_t *)adst;
+
+	while (alen)
+	{
+		unsigned n = (alen > CRC_COPY_CHUNK ? CRC_COPY_CHUNK : alen);
+		acrc = crc16_modbus(acrc, src, n);
+		for (unsigned i = 0; i < n; ++i)
+		{
+			dst[i] = src[i];
+		}
+		src += n;
+		dst += n;
+		alen -= n;
+	}
+
+	return acrc;
+}
+
+uint16_t crc16_ccitt(uint16_t acrc, const void * adata, unsigned alen)
+{
+	crc_check_tables();
+
+	const uint8_t * p = (const uint8_t *)adata;
+	uint16_t crc = acrc;
+
+	while (alen)
+	{
+		crc = (crc << 8) ^ crc16_ccitt_table[((crc >> 8) ^ *p++) & 0xFF];
+		--alen;
+	}
+
+	return crc;
+}
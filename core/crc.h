@@ -0,0 +1,51 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVHAL project: https://github.com/nvitya/nvhal
+ * Copyright (c) 2020 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     crc.h
+ *  brief:    CRC16 / CRC32 calculation for serial framing
+ *  version:  1.00
+ *  date:     2026-10-19
+ *  authors:  nvitya
+ *  notes:
+ *    The functions can be chained, pass the result of the previous call as acrc.
+ *    The *_copy() variants copy the data into a (DMA) buffer while checksumming it.
+*/
+
+#ifndef CRC_H_
+#define CRC_H_
+
+#include "platform.h"
+
+#define CRC32_INIT          0x00000000  // IEEE 802.3 / zlib, reflected 0x04C11DB7
+#define CRC16_MODBUS_INIT   0xFFFF      // reflected 0x8005
+#define CRC16_CCITT_INIT    0xFFFF      // CCITT-FALSE, 0x1021
+
+uint32_t crc32_calc(uint32_t acrc, const void * adata, unsigned alen);
+uint32_t crc32_copy(uint32_t acrc, void * adst, const void * asrc, unsigned alen);
+
+uint16_t crc16_modbus(uint16_t acrc, const void * adata, unsigned alen);
+uint16_t crc16_modbus_copy(uint16_t acrc, void * adst, const void * asrc, unsigned alen);
+
+uint16_t crc16_ccitt(uint16_t acrc, const void * adata, unsigned alen);
+
+bool crc32_hw_available();  // CRC32 instructions (ARMv8) are used
+
+#endif /* CRC_H_ */
@@ -0,0 +1,183 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVHAL project: https://github.com/nvitya/nvhal
+ * Copyright (c) 2020 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hw_broker.cpp
+ *  brief:    Hardware resource ownership shared between processes
+ *  version:  1.00
+ *  date:     2026-10-19
+ *  authors:  nvitya
+*/
+
+#include "platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "hw_broker.h"
+
+#define HWRES_MAGIC  0x5345524E  // "NRES"
+
+struct THwResourceShm
+{
+	uint32_t     magic;
+	int32_t      owner[HWRES_TYPES][HWRES_MAX_UNITS];  // PID, 0 = free
+};
+
+static THwResourceShm *  g_hwres_shm = nullptr;
+static pthread_once_t    g_hwres_once = PTHREAD_ONCE_INIT;  // the PinSetup() might be called from more threads
+static bool              g_hwres_bypass = false;
+static int32_t           g_hwres_pid = 0;  // cached, the claims are on the PinSetup() path
+
+static void hwres_atfork_child()
+{
+	g_hwres_pid = getpid();
+}
+
+static void hwres_open_once()
+{
+	g_hwres_pid = getpid();
+	pthread_atfork(nullptr, nullptr, hwres_atfork_child);
+
+	int fd = shm_open(HWRES_SHM_NAME, O_RDWR | O_CREAT, 0666);
+	if (fd < 0)
+	{
+		printf("hw_broker: shared memory is not available, resources are not coordinated\n");
+		return;
+	}
+
+	// the new shared memory is zero filled, which means all free
+	if (ftruncate(fd, sizeof(THwResourceShm)) == 0)
+	{
+		void * p = mmap(nullptr, sizeof(THwResourceShm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (p != MAP_FAILED)
+		{
+			g_hwres_shm = (THwResourceShm *)p;
+			uint32_t expected = 0;
+			__atomic_compare_exchange_n(&g_hwres_shm->magic, &expected, HWRES_MAGIC, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+			atexit(hwres_release_all);
+		}
+	}
+	close(fd);
+}
+
+static THwResourceShm * hwres_open()
+{
+	if (__atomic_load_n(&g_hwres_bypass, __ATOMIC_RELAXED))
+	{
+		return nullptr;
+	}
+
+	pthread_once(&g_hwres_once, hwres_open_once);
+	return g_hwres_shm;
+}
+
+static bool hwres_pid_alive(int apid)
+{
+	return (apid > 0) && ((kill(apid, 0) == 0) || (errno == EPERM));
+}
+
+bool hwres_claim(unsigned atype, unsigned aunit)
+{
+	if ((atype >= HWRES_TYPES) || (aunit >= HWRES_MAX_UNITS))
+	{
+		return false;
+	}
+
+	THwResourceShm * shm = hwres_open();
+	if (!shm)
+	{
+		return true;
+	}
+
+	int32_t * powner = &shm->owner[atype][aunit];
+	int32_t   mypid = g_hwres_pid;
+	if (__atomic_load_n(powner, __ATOMIC_ACQUIRE) == mypid)
+	{
+		return true;  // already ours: the usual case for a reconfiguration, no atomic exchange
+	}
+
+	int32_t   expected = 0;
+	while (!__atomic_compare_exchange_n(powner, &expected, mypid, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	{
+		if (expected == mypid)
+		{
+			return true;  // already ours
+		}
+
+		if (hwres_pid_alive(expected))
+		{
+			return false;
+		}
+
+		// the owner died, try to take it over (expected holds the dead PID)
+	}
+
+	return true;
+}
+
+void hwres_release(unsigned atype, unsigned aunit)
+{
+	if ((atype >= HWRES_TYPES) || (aunit >= HWRES_MAX_UNITS) || !hwres_open())
+	{
+		return;
+	}
+
+	int32_t expected = g_hwres_pid;
+	__atomic_compare_exchange_n(&g_hwres_shm->owner[atype][aunit], &expected, 0, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+int hwres_owner(unsigned atype, unsigned aunit)
+{
+	if ((atype >= HWRES_TYPES) || (aunit >= HWRES_MAX_UNITS) || !hwres_open())
+	{
+		return 0;
+	}
+
+	int32_t owner = __atomic_load_n(&g_hwres_shm->owner[atype][aunit], __ATOMIC_ACQUIRE);
+	return (hwres_pid_alive(owner) ? owner : 0);
+}
+
+void hwres_release_all()
+{
+	if (!g_hwres_shm)
+	{
+		return;
+	}
+
+	for (unsigned t = 0; t < HWRES_TYPES; ++t)
+	{
+		for (unsigned u = 0; u < HWRES_MAX_UNITS; ++u)
+		{
+			hwres_release(t, u);
+		}
+	}
+}
+
+void hwres_bypass(bool abypass)
+{
+	__atomic_store_n(&g_hwres_bypass, abypass, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,58 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVHAL project: https://github.com/nvitya/nvhal
+ * Copyright (c) 2020 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hw_broker.h
+ *  brief:    Hardware resource ownership shared between processes
+ *  version:  1.00
+ *  date:     2026-10-19
+ *  authors:  nvitya
+ *  notes:
+ *    The owner PIDs are stored in a POSIX shared memory, claimed with atomic
+ *    compare-exchange. The resources of a crashed process are taken over when its
+ *    PID does not exist anymore. Without the shared memory every claim succeeds,
+ *    the same happens in the bypass mode, which does not touch the shared memory.
+*/
+
+#ifndef HW_BROKER_H_
+#define HW_BROKER_H_
+
+#include "stdint.h"
+
+#define HWRES_SHM_NAME      "/nvhal_resources"
+
+#define HWRES_DMA_CHANNEL   0
+#define HWRES_UART          1
+#define HWRES_GPIO_PIN      2
+#define HWRES_ARENA         3  // memory regions, the units from HWRES_ARENA_APP are free for the applications
+
+#define HWRES_ARENA_DMA     0  // the persistent VPU DMA arena (hwdma_broadcom)
+#define HWRES_ARENA_APP     8
+
+#define HWRES_TYPES         4
+#define HWRES_MAX_UNITS    64
+
+bool     hwres_claim(unsigned atype, unsigned aunit);    // false = used by an other living process
+void     hwres_release(unsigned atype, unsigned aunit);
+int      hwres_owner(unsigned atype, unsigned aunit);    // PID of the owner, 0 = free
+void     hwres_release_all();                            // releases the resources of this process
+void     hwres_bypass(bool abypass);                     // true = no coordination, for the simulated register sets
+
+#endif /* HW_BROKER_H_ */
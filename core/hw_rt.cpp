@@ -0,0 +1,180 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVHAL project: https://github.com/nvitya/nvhal
+ * Copyright (c) 2020 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hw_rt.cpp
+ *  brief:    Real-time execution setup for the latency critical loops
+ *  version:  1.00
+ *  date:     2026-10-19
+ *  authors:  nvitya
+*/
+
+#include "platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <alloca.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#include "hw_rt.h"
+#include "clockcnt.h"
+
+bool hwrt_lock_memory()
+{
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+	{
+		printf("hwrt: mlockall failed\n");
+		return false;
+	}
+	return true;
+}
+
+void hwrt_prefault(void * aaddr, unsigned asize)
+{
+	unsigned pagesize = sysconf(_SC_PAGESIZE);
+	volatile uint8_t * p = (volatile uint8_t *)aaddr;
+	for (unsigned offs = 0; offs < asize; offs += pagesize)
+	{
+		p[offs] = p[offs];
+	}
+}
+
+void hwrt_prefault_stack(unsigned asize)
+{
+	uint8_t * buf = (uint8_t *)alloca(asize);
+	memset(buf, 0, asize);
+	asm volatile ("" : : "r" (buf) : "memory");  // keep the memset
+}
+
+int hwrt_isolated_cpu()
+{
+	FILE * f = fopen("/sys/devices/system/cpu/isolated", "r");
+	if (!f)
+	{
+		return -1;
+	}
+
+	// list format: "2-3" or "1,3"
+	int result = -1;
+	char line[128];
+	if (fgets(line, sizeof(line), f))
+	{
+		char * p = line;
+		while (*p)
+		{
+			if ((*p >= '0') && (*p <= '9'))
+			{
+				result = strtol(p, &p, 10);
+			}
+			else
+			{
+				++p;
+			}
+		}
+	}
+
+	fclose(f);
+	return result;
+}
+
+bool hwrt_set_affinity(int acpu)
+{
+	cpu_set_t cpuset;
+	CPU_ZERO(&cpuset);
+	CPU_SET(acpu, &cpuset);
+	if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) != 0)
+	{
+		printf("hwrt: error setting the CPU affinity to %i\n", acpu);
+		return false;
+	}
+	return true;
+}
+
+bool hwrt_set_fifo(int apriority)
+{
+	struct sched_param param;
+	memset(&param, 0, sizeof(param));
+	param.sched_priority = apriority;
+	if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+	{
+		printf("hwrt: error setting SCHED_FIFO priority %i\n", apriority);
+		return false;
+	}
+	return true;
+}
+
+bool hwrt_setup(int acpu, int apriority)
+{
+	bool result = hwrt_lock_memory();
+
+	hwrt_prefault_stack(256 * 1024);
+
+	if (acpu < 0)
+	{
+		acpu = hwrt_isolated_cpu();
+	}
+
+	if ((acpu >= 0) && !hwrt_set_affinity(acpu))
+	{
+		result = false;
+	}
+
+	if ((apriority > 0) && !hwrt_set_fifo(apriority))
+	{
+		result = false;
+	}
+
+	return result;
+}
+
+void hwrt_measure_jitter(unsigned aperiod_us, unsigned asamples, THwRtJitter * rresult)
+{
+	rresult->latency.Reset();
+
+	clockcnt_t period = clockcnt_t(aperiod_us) * (CLOCKCNT_SPEED / 1000000);
+	clockcnt_t target = CLOCKCNT;
+
+	for (unsigned n = 0; n < asamples; ++n)
+	{
+		target += period;
+		clockcnt_t now = CLOCKCNT;
+		if (target > now)
+		{
+			usleep(unsigned((target - now) / (CLOCKCNT_SPEED / 1000000)));
+		}
+
+		now = CLOCKCNT;
+		rresult->latency.Add(now > target ? now - target : 0);
+
+		if (now > target + period)
+		{
+			target = now;  // do not try to catch up the missed periods
+		}
+	}
+}
+
+void hwrt_print_jitter(THwRtJitter * ajitter)
+{
+	ajitter->latency.Print(stdout, "Wake-up latency", CLOCKCNT_SPEED / 1000000, "us");
+}
@@ -0,0 +1,58 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVHAL project: https://github.com/nvitya/nvhal
+ * Copyright (c) 2020 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hw_rt.h
+ *  brief:    Real-time execution setup for the latency critical loops
+ *  version:  1.00
+ *  date:     2026-10-19
+ *  authors:  nvitya
+ *  notes:
+ *    The /dev/mem mappings (MMIO and the VPU DMA arena) are populated by the kernel
+ *    at mmap time, the cached DMA arenas are mapped with MAP_LOCKED | MAP_POPULATE,
+ *    so after hwrt_lock_memory() only the stack and the heap need prefaulting.
+*/
+
+#ifndef HW_RT_H_
+#define HW_RT_H_
+
+#include "stdint.h"
+#include "hwprofile.h"
+
+struct THwRtJitter
+{
+	THwHistogram   latency;  // wake-up lateness in clocks
+};
+
+bool hwrt_lock_memory();  // mlockall() current and future
+void hwrt_prefault(void * aaddr, unsigned asize);  // writes every page, only for RAM
+void hwrt_prefault_stack(unsigned asize);
+int  hwrt_isolated_cpu();  // the last CPU from the isolcpus= list, -1 = none
+bool hwrt_set_affinity(int acpu);  // pins the calling thread
+bool hwrt_set_fifo(int apriority);  // SCHED_FIFO for the calling thread, 1..99
+
+// all of the above, acpu = -1: an isolated CPU when there is one
+bool hwrt_setup(int acpu, int apriority);
+
+// wakes up asamples times with aperiod_us period and measures the lateness with clockcnt()
+void hwrt_measure_jitter(unsigned aperiod_us, unsigned asamples, THwRtJitter * rresult);
+void hwrt_print_jitter(THwRtJitter * ajitter);
+
+#endif /* HW_RT_H_ */
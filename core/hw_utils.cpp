@@ -34,38 +34,219 @@
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <unistd.h>
+#include <pthread.h>
+
+#include "hw_utils.h"
 
 #define MEM_PAGE_SIZE   (4 * 1024)
+#define HW_MEMMAP_MAX   32
 
-void * hw_memmap(uintptr_t aaddr, unsigned asize)
+struct THwMemmapEntry
 {
-	int  mem_fd;
+	uintptr_t    physaddr;  // page aligned
+	size_t       size;      // page aligned
+	uint8_t *    virtaddr;
+	unsigned     refcnt;
+};
+
+static int                g_hw_mem_fd = -1;
+static THwMemmapEntry     g_hw_memmap[HW_MEMMAP_MAX] = {};
+static THwMemmapStats     g_hw_memmap_stats = {};
+static pthread_mutex_t    g_hw_memmap_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-	mem_fd = open("/dev/mem", O_RDWR | O_SYNC);
-	if (mem_fd < 0)
+static THwMemmapEntry * hw_memmap_new_entry(uintptr_t aphysaddr, size_t asize)
+{
+	THwMemmapEntry * entry = nullptr;
+	for (unsigned n = 0; n < HW_MEMMAP_MAX; ++n)
 	{
-		return nullptr;
+		if (0 == g_hw_memmap[n].refcnt)
+		{
+			entry = &g_hw_memmap[n];
+			break;
+		}
 	}
 
-	uintptr_t startaddr = aaddr & ~(MEM_PAGE_SIZE - 1);
-
-	size_t memblksize = ((asize + (MEM_PAGE_SIZE - 1)) & ~MEM_PAGE_SIZE);
+	if (!entry)
+	{
+		printf("hw_memmap: too many mappings\n");
+		return nullptr;
+	}
 
-	uint8_t * mmapresult = (uint8_t *)mmap(
+	void * mmapresult = mmap(
     nullptr,                 // target address within our address space, nullptr = selected by the system
-    memblksize,              // map length
+    asize,                   // map length
     PROT_READ | PROT_WRITE,  // Enable reading & writting to mapped memory
     MAP_SHARED,              // shared with other processes
-    mem_fd,                  // file to map
-    startaddr // offset
+    g_hw_mem_fd,             // file to map
+    aphysaddr // offset
    );
 
-	close(mem_fd); // not required anymore
+	++g_hw_memmap_stats.mmap_calls;
 
 	if (mmapresult == MAP_FAILED)
 	{
 		return nullptr;
 	}
 
-	return mmapresult + (aaddr & (MEM_PAGE_SIZE - 1));
+	entry->physaddr = aphysaddr;
+	entry->size = asize;
+	entry->virtaddr = (uint8_t *)mmapresult;
+	entry->refcnt = 0;
+
+	++g_hw_memmap_stats.mappings;
+	g_hw_memmap_stats.mapped_bytes += asize;
+
+	return entry;
+}
+
+void * hw_memmap(uintptr_t aaddr, unsigned asize)
+{
+	pthread_mutex_lock(&g_hw_memmap_mutex);
+
+	++g_hw_memmap_stats.requests;
+
+	if (g_hw_mem_fd < 0)
+	{
+		g_hw_mem_fd = open("/dev/mem", O_RDWR | O_SYNC);  // kept open for the further mappings
+	}
+
+	if (g_hw_mem_fd < 0)
+	{
+		pthread_mutex_unlock(&g_hw_memmap_mutex);
+		return nullptr;
+	}
+
+	uintptr_t startaddr = aaddr & ~uintptr_t(MEM_PAGE_SIZE - 1);
+	uintptr_t endaddr = (aaddr + asize + (MEM_PAGE_SIZE - 1)) & ~uintptr_t(MEM_PAGE_SIZE - 1);
+
+	// already mapped ?
+	THwMemmapEntry * entry = nullptr;
+	for (unsigned n = 0; n < HW_MEMMAP_MAX; ++n)
+	{
+		THwMemmapEntry * e = &g_hw_memmap[n];
+		if (e->refcnt && (startaddr >= e->physaddr) && (endaddr <= e->physaddr + e->size))
+		{
+			entry = e;
+			++g_hw_memmap_stats.shared_hits;
+			break;
+		}
+	}
+
+#ifdef HW_PERIPH_WINDOW_BASE
+	if (!entry && (startaddr >= HW_PERIPH_WINDOW_BASE) && (endaddr <= HW_PERIPH_WINDOW_BASE + HW_PERIPH_WINDOW_SIZE))
+	{
+		entry = hw_memmap_new_entry(HW_PERIPH_WINDOW_BASE, HW_PERIPH_WINDOW_SIZE);  // falls back to the range below
+	}
+#endif
+
+	if (!entry)
+	{
+		entry = hw_memmap_new_entry(startaddr, endaddr - startaddr);
+	}
+
+	uint8_t * result = nullptr;
+	if (entry)
+	{
+		++entry->refcnt;
+		result = entry->virtaddr + (aaddr - entry->physaddr);
+	}
+
+	pthread_mutex_unlock(&g_hw_memmap_mutex);
+	return result;
+}
+
+void hw_memunmap(void * aptr)
+{
+	pthread_mutex_lock(&g_hw_memmap_mutex);
+
+	for (unsigned n = 0; n < HW_MEMMAP_MAX; ++n)
+	{
+		THwMemmapEntry * e = &g_hw_memmap[n];
+		if (e->refcnt && ((uint8_t *)aptr >= e->virtaddr) && ((uint8_t *)aptr < e->virtaddr + e->size))
+		{
+			if (--e->refcnt == 0)
+			{
+				munmap(e->virtaddr, e->size);
+				++g_hw_memmap_stats.munmap_calls;
+				--g_hw_memmap_stats.mappings;
+				g_hw_memmap_stats.mapped_bytes -= e->size;
+			}
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&g_hw_memmap_mutex);
+}
+
+void hw_memmap_stats(THwMemmapStats * rstats)
+{
+	pthread_mutex_lock(&g_hw_memmap_mutex);
+	*rstats = g_hw_memmap_stats;
+	pthread_mutex_unlock(&g_hw_memmap_mutex);
+}
+
+uint64_t hw_pagemap_entry_to_phys(uint64_t aentry, uintptr_t avaddr, unsigned asyspagesize)
+{
+	// bit 63: present, bits 0-54: page frame number (zero without CAP_SYS_ADMIN)
+	if (0 == (aentry & (1ull << 63)))
+	{
+		return 0;
+	}
+
+	uint64_t pfn = (aentry & ((1ull << 55) - 1));
+	if (0 == pfn)
+	{
+		return 0;
+	}
+
+	return pfn * asyspagesize + (avaddr & (asyspagesize - 1));
+}
+
+static uint64_t hw_pagemap_read(int afd, uintptr_t avaddr, unsigned asyspagesize)
+{
+	uint64_t  entry = 0;
+	ssize_t r = pread(afd, &entry, sizeof(entry), (avaddr / asyspagesize) * sizeof(entry));
+	if (r != sizeof(entry))
+	{
+		return 0;
+	}
+	return hw_pagemap_entry_to_phys(entry, avaddr, asyspagesize);
+}
+
+uint64_t hw_virt_to_phys(void * aaddr)
+{
+	int fd = open("/proc/self/pagemap", O_RDONLY);
+	if (fd < 0)
+	{
+		return 0;
+	}
+
+	uint64_t result = hw_pagemap_read(fd, uintptr_t(aaddr), sysconf(_SC_PAGESIZE));
+	close(fd);
+	return result;
+}
+
+bool hw_virt_to_phys_pages(void * aaddr, unsigned apagecount, unsigned apagesize, uint64_t * rphys)
+{
+	int fd = open("/proc/self/pagemap", O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	// the pagemap has entries for the system pages, the first one is enough for larger pages
+	unsigned syspagesize = sysconf(_SC_PAGESIZE);
+	bool result = true;
+	for (unsigned n = 0; n < apagecount; ++n)
+	{
+		rphys[n] = hw_pagemap_read(fd, uintptr_t(aaddr) + uintptr_t(n) * apagesize, syspagesize);
+		if (0 == rphys[n])
+		{
+			result = false;
+			break;
+		}
+	}
+
+	close(fd);
+	return result;
 }
@@ -31,6 +31,31 @@
 
 #include "stdint.h"
 
+// The mappings are shared: an already mapped range (or the peripheral window when
+// the platform defines HW_PERIPH_WINDOW_BASE) is reused and reference counted.
 void * hw_memmap(uintptr_t aaddr, unsigned asize);
+void   hw_memunmap(void * aptr);  // releases a pointer returned by hw_memmap()
+
+struct THwMemmapStats
+{
+	unsigned     mappings;      // active mmap regions
+	uint64_t     mapped_bytes;
+	unsigned     requests;      // hw_memmap() calls
+	unsigned     shared_hits;   // requests served from an existing mapping
+	unsigned     mmap_calls;
+	unsigned     munmap_calls;
+};
+
+void hw_memmap_stats(THwMemmapStats * rstats);
+
+// physical address of a locked user page from /proc/self/pagemap, requires root
+// returns 0 when the page is not present or the PFN is hidden
+uint64_t hw_virt_to_phys(void * aaddr);
+
+// physical start address of apagecount pages of apagesize (e.g. hugepages)
+bool     hw_virt_to_phys_pages(void * aaddr, unsigned apagecount, unsigned apagesize, uint64_t * rphys);
+
+// decodes a pagemap entry of the (system page size) virtual page containing avaddr
+uint64_t hw_pagemap_entry_to_phys(uint64_t aentry, uintptr_t avaddr, unsigned asyspagesize);
 
 #endif /* HW_UTILS_H_ */
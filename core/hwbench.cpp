@@ -0,0 +1,174 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVHAL project: https://github.com/nvitya/nvhal
+ * Copyright (c) 2020 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwbench.cpp
+ *  brief:    Benchmarks for the HAL hot paths
+ *  version:  1.00
+ *  date:     2026-10-19
+ *  authors:  nvitya
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "hwbench.h"
+#include "clockcnt.h"
+#include "crc.h"
+
+double THwBench::NowNs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return double(ts.tv_sec) * 1e9 + double(ts.tv_nsec);
+}
+
+void THwBench::Add(const char * aname, double avalue, const char * aunit, unsigned aiterations)
+{
+	if (result_count >= HWBENCH_MAX_RESULTS)
+	{
+		return;
+	}
+
+	THwBenchResult * r = &results[result_count++];
+	strncpy(r->name, aname, sizeof(r->name) - 1);
+	r->name[sizeof(r->name) - 1] = 0;
+	strncpy(r->unit, aunit, sizeof(r->unit) - 1);
+	r->unit[sizeof(r->unit) - 1] = 0;
+	r->value = avalue;
+	r->iterations = aiterations;
+	r->simulated = simulated;
+}
+
+bool THwBench::Run(bool aforcesim)
+{
+	result_count = 0;
+
+	bool hwok = false;
+	if (!aforcesim)
+	{
+		simulated = false;
+		hwok = RunPlatform();
+	}
+
+	simulated = true;  // the RAM registers, next to the hardware results for comparison
+	RunPlatform();
+
+	simulated = !hwok;
+	RunGeneric();  // clockcnt() falls back to the system clock without hardware too
+
+	return (result_count > 0);
+}
+
+// bitwise reference for the table / instruction based CRC32
+static uint32_t hwbench_crc32_bitwise(uint32_t acrc, const uint8_t * adata, unsigned alen)
+{
+	acrc = ~acrc;
+	while (alen--)
+	{
+		acrc ^= *adata++;
+		for (unsigned b = 0; b < 8; ++b)
+		{
+			acrc = (acrc >> 1) ^ (0xEDB88320 & (0 - (acrc & 1)));
+		}
+	}
+	return ~acrc;
+}
+
+void THwBench::RunGeneric()
+{
+	double t0, t1;
+	volatile clockcnt_t sink = 0;
+
+	// clockcnt() read cost
+
+	t0 = NowNs();
+	for (unsigned n = 0; n < iterations; ++n)
+	{
+		sink = CLOCKCNT;
+	}
+	t1 = NowNs();
+	Add("clockcnt_read", (t1 - t0) / iterations, "ns", iterations);
+
+	// delay_us() accuracy: average overshoot of the requested time
+
+	const unsigned delaycnt = 100;
+	double overshoot = 0;
+	for (unsigned n = 0; n < delaycnt; ++n)
+	{
+		t0 = NowNs();
+		delay_us(100);
+		t1 = NowNs();
+		overshoot += (t1 - t0) - 100000.0;
+	}
+	Add("delay_us_100_error", overshoot / delaycnt / 1000.0, "us", delaycnt);
+
+	// CRC32 throughput compared to the bitwise calculation
+
+	static uint8_t crcbuf[4096];
+	for (unsigned n = 0; n < sizeof(crcbuf); ++n)
+	{
+		crcbuf[n] = uint8_t(n * 7);
+	}
+
+	const unsigned crcloops = 1000;
+	volatile uint32_t crc = 0;
+
+	t0 = NowNs();
+	for (unsigned n = 0; n < crcloops; ++n)
+	{
+		crc = crc32_calc(0, &crcbuf[0], sizeof(crcbuf));
+	}
+	t1 = NowNs();
+	Add(crc32_hw_available() ? "crc32_hw" : "crc32_sliced", (double(sizeof(crcbuf)) * crcloops * 1000.0) / (t1 - t0), "MB/s", crcloops);
+
+	t0 = NowNs();
+	for (unsigned n = 0; n < crcloops / 10; ++n)
+	{
+		crc = hwbench_crc32_bitwise(0, &crcbuf[0], sizeof(crcbuf));
+	}
+	t1 = NowNs();
+	Add("crc32_bitwise", (double(sizeof(crcbuf)) * (crcloops / 10) * 1000.0) / (t1 - t0), "MB/s", crcloops / 10);
+
+	(void)sink;
+	(void)crc;
+}
+
+void THwBench::PrintText(FILE * afile)
+{
+	for (unsigned n = 0; n < result_count; ++n)
+	{
+		THwBenchResult * r = &results[n];
+		fprintf(afile, "%-28s %12.3f %-5s (%u iterations%s)\n", r->name, r->value, r->unit,
+				r->iterations, (r->simulated ? ", simulated" : ""));
+	}
+}
+
+void THwBench::PrintCsv(FILE * afile)
+{
+	fprintf(afile, "name,value,unit,iterations,backend\n");
+	for (unsigned n = 0; n < result_count; ++n)
+	{
+		THwBenchResult * r = &results[n];
+		fprintf(afile, "%s,%.6g,%s,%u,%s\n", r->name, r->value, r->unit, r->iterations,
+				(r->simulated ? "sim" : "hw"));
+	}
+}
@@ -0,0 +1,75 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVHAL project: https://github.com/nvitya/nvhal
+ * Copyright (c) 2020 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwbench.h
+ *  brief:    Benchmarks for the HAL hot paths
+ *  version:  1.00
+ *  date:     2026-10-19
+ *  authors:  nvitya
+ *  notes:
+ *    The generic measurements are in hwbench.cpp, the hardware specific ones in
+ *    the hwbench_<cpu>.cpp (RunPlatform). In the simulated mode the drivers work on
+ *    register sets in RAM, so the software overhead can be measured on any host.
+ *    The times are measured with clock_gettime(), independently from clockcnt().
+*/
+
+#ifndef HWBENCH_H_
+#define HWBENCH_H_
+
+#include "platform.h"
+#include "stdio.h"
+
+#define HWBENCH_MAX_RESULTS  64
+
+struct THwBenchResult
+{
+	char         name[40];
+	char         unit[12];
+	double       value;
+	unsigned     iterations;
+	bool         simulated;
+};
+
+class THwBench
+{
+public:
+	bool             simulated = false;  // backend of the running measurements, Run() does both when the hardware is accessible
+	unsigned         iterations = 100000;
+	int              gpio_pin = -1;     // pin for the hardware GPIO measurements, -1 = skip
+	int              uart_devnum = -1;  // UART for the hardware UART measurements, -1 = skip
+	unsigned         result_count = 0;
+	THwBenchResult   results[HWBENCH_MAX_RESULTS];
+
+	bool             Run(bool aforcesim = false);
+
+	void             PrintText(FILE * afile);
+	void             PrintCsv(FILE * afile);  // name,value,unit,iterations,backend
+
+public:
+	double           NowNs();
+	void             Add(const char * aname, double avalue, const char * aunit, unsigned aiterations);
+
+protected:
+	void             RunGeneric();
+	bool             RunPlatform();  // cpu specific, false = no hardware access
+};
+
+#endif /* HWBENCH_H_ */
@@ -26,7 +26,127 @@
  *  authors:  nvitya
 */
 
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+
 #include <hwdma.h>
+#include "clockcnt.h"
+
+#define DMA_WAIT_SPIN_US        20  // shorter sleeps are not worth it
+#define DMA_WAIT_MAX_SLEEP_US  2000
+
+bool THwDmaChannel::AttachIrq(const char * auiodevname)
+{
+	if (irqfd >= 0)
+	{
+		close(irqfd);
+	}
+
+	irqfd = open(auiodevname, O_RDWR);
+	if (irqfd < 0)
+	{
+		printf("DMA: error opening the interrupt device \"%s\"\n", auiodevname);
+		return false;
+	}
+
+	uint32_t enable = 1;  // unmask the interrupt
+	if (write(irqfd, &enable, sizeof(enable)) != sizeof(enable))
+	{
+		close(irqfd);
+		irqfd = -1;
+		return false;
+	}
+
+	return true;
+}
+
+void THwDmaChannel::SetCallback(PDmaCompleteFunc afunc, void * aarg)
+{
+	oncomplete_arg = aarg;
+	oncomplete = afunc;
+}
+
+bool THwDmaChannel::Service()
+{
+	if (!complete_pending || Active())
+	{
+		return false;
+	}
+
+	complete_pending = false;
+	FinishTransfer();
+	if (oncomplete)
+	{
+		oncomplete(this, oncomplete_arg);
+	}
+
+	return true;
+}
+
+bool THwDmaChannel::Wait(unsigned atimeout_us)
+{
+	clockcnt_t t0 = CLOCKCNT;
+	clockcnt_t timeout = clockcnt_t(atimeout_us) * (CLOCKCNT_SPEED / 1000000);
+	unsigned   backoff_us = 1;
+
+	while (Active())
+	{
+		clockcnt_t elapsed = CLOCKCNT - t0;
+		if (elapsed >= timeout)
+		{
+			return false;
+		}
+
+		unsigned timeleft_us = unsigned((timeout - elapsed) / (CLOCKCNT_SPEED / 1000000));
+
+		if (irqfd >= 0)
+		{
+			struct pollfd pfd = {irqfd, POLLIN, 0};
+			int pollms = (timeleft_us + 999) / 1000;
+			if (poll(&pfd, 1, pollms) > 0)
+			{
+				uint32_t irqcnt;
+				if (read(irqfd, &irqcnt, sizeof(irqcnt)) == sizeof(irqcnt))
+				{
+					AckIrq();  // the level interrupt would fire again right after the unmask
+					uint32_t enable = 1;
+					ssize_t r = write(irqfd, &enable, sizeof(enable));  // unmask for the next one
+					(void)r;
+				}
+			}
+			continue;
+		}
+
+		unsigned sleep_us;
+		if (xfer_rate)
+		{
+			// sleep 3/4 of the expected remaining time, so the completion is not overslept much
+			sleep_us = unsigned((uint64_t(Remaining()) * 750000) / xfer_rate);
+		}
+		else
+		{
+			sleep_us = backoff_us;
+			if (backoff_us < DMA_WAIT_MAX_SLEEP_US)  backoff_us <<= 1;
+		}
+
+		if (sleep_us > DMA_WAIT_MAX_SLEEP_US)  sleep_us = DMA_WAIT_MAX_SLEEP_US;
+		if (sleep_us > timeleft_us)            sleep_us = timeleft_us;
+
+		if (sleep_us >= DMA_WAIT_SPIN_US)
+		{
+			usleep(sleep_us);
+		}
+	}
+
+	if (!Service())
+	{
+		FinishTransfer();  // started without StartTransfer()
+	}
+
+	return true;
+}
 
 
 
@@ -38,8 +38,11 @@
 #define DMATR_NO_DST_INC    0x0002
 #define DMATR_MEM_TO_MEM    0x0008
 #define DMATR_IRQ           0x0010
+#define DMATR_2D            0x0020  // ycount rows of xlength bytes with strides
 #define DMATR_CIRCULAR      0x0100
 
+#define DMAXFER_AUTO        0xFF  // use the default of the transfer type for the bus tuning fields
+
 class THwDmaTransfer
 {
 public:
@@ -48,8 +51,34 @@ public:
 	uint8_t     bytewidth = 1;  // 1, 2 or 4
 	uint32_t    count = 0;
 	uint32_t    flags = 0;
+
+	// 2D transfers (DMATR_2D): the count and bytewidth are not used,
+	// the strides are added to the memory addresses after each row
+	uint16_t    xlength = 0;    // bytes per row
+	uint16_t    ycount = 0;     // number of rows
+	int16_t     srcstride = 0;
+	int16_t     dststride = 0;
+
+	// bus access tuning (where the DMA controller supports it)
+	uint8_t     burstlength = DMAXFER_AUTO;  // accesses per burst, 0 = single accesses
+	uint8_t     waits = DMAXFER_AUTO;        // wait cycles after each access
+	uint8_t     widebursts = DMAXFER_AUTO;   // 1 = wide (2 beat) bursts
+	uint8_t     buswidth = DMAXFER_AUTO;     // memory-to-memory access width in bytes: 4, 8, 16
 };
 
+struct THwDmaProgress
+{
+	uint64_t     bytes_done;  // total, including the previous laps of a circular transfer
+	unsigned     position;    // offset in the current lap
+	unsigned     remaining;   // bytes remaining from the current lap
+	unsigned     laps;        // completed laps of a circular transfer
+	bool         finished;
+};
+
+class THwDmaChannel;
+
+typedef void (* PDmaCompleteFunc)(THwDmaChannel * adma, void * aarg);
+
 class THwDmaChannel_pre
 {
 public:
@@ -58,6 +87,24 @@ public:
 	int           		 chnum = -1;
 	bool               initialized = false;
 	int                priority = 7;
+
+public: // completion
+	unsigned           xfer_rate = 0;  // expected speed in bytes / s for Wait(), 0 = unknown
+	int                irqfd = -1;     // UIO device of the channel interrupt
+
+	PDmaCompleteFunc   oncomplete = nullptr;
+	void *             oncomplete_arg = nullptr;
+
+protected:
+	bool               complete_pending = false;
+
+	// progress tracking, set by PrepareTransfer()
+	unsigned           xfer_length = 0;  // bytes of one lap
+	bool               xfer_circular = false;
+	bool               xfer_started = false;  // set by StartPreparedTransfer()
+	bool               xfer_prepared = false; // the last PrepareTransfer() succeeded, the CB belongs to it
+	unsigned           prog_laps = 0;
+	unsigned           prog_lastpos = 0;
 };
 
 #endif // ndef HWDMA_H_PRE_
@@ -91,10 +138,13 @@ public: // mandatory
 	bool Enabled() { return false; }
 	bool Active()  { return false; }
 
-	void PrepareTransfer(THwDmaTransfer * axfer)  { }
-	void StartPreparedTransfer()  { }
+	bool PrepareTransfer(THwDmaTransfer * axfer)  { return false; }
+	bool StartPreparedTransfer()  { return false; }
 
 	unsigned Remaining() { return 0; }
+	void GetProgress(THwDmaProgress * rprog)  { *rprog = {}; }
+	void FinishTransfer()  { }
+	void AckIrq()  { }
 };
 
 #define HWDMACHANNEL_IMPL THwDmaChannel_noimpl
@@ -109,10 +159,36 @@ public: // mandatory
 class THwDmaChannel : public HWDMACHANNEL_IMPL
 {
 public:
-	inline void StartTransfer(THwDmaTransfer * axfer)
+	inline bool StartTransfer(THwDmaTransfer * axfer)  // false = unsupported transfer, nothing started
+	{
+		if (!PrepareTransfer(axfer))
+		{
+			return false;
+		}
+		complete_pending = true;
+		return StartPreparedTransfer();
+	}
+
+	// Completion without busy polling. With a UIO interrupt device (AttachIrq) the
+	// thread sleeps until the interrupt, otherwise it sleeps for the most of the
+	// expected remaining transfer time (from xfer_rate) and polls only the rest.
+	bool Wait(unsigned atimeout_us);  // false = timeout
+	bool AttachIrq(const char * auiodevname);
+	void SetCallback(PDmaCompleteFunc afunc, void * aarg);
+	bool Service();  // calls the callback once after the completion, returns true then
+
+	// asynchronous memory copy, check the completion with Active()
+	// both buffers must be DMA accessible (see hwdma_allocate_dma_buffer())
+	// false = not started (e.g. longer than a Lite channel can transfer), it is not truncated
+	inline bool StartMemCopy(void * adst, void * asrc, unsigned alen)
 	{
-		PrepareTransfer(axfer);
-		StartPreparedTransfer();
+		THwDmaTransfer xfer;
+		xfer.srcaddr = asrc;
+		xfer.dstaddr = adst;
+		xfer.bytewidth = 1;
+		xfer.count = alen;
+		xfer.flags = DMATR_MEM_TO_MEM;
+		return StartTransfer(&xfer);
 	}
 };
 
@@ -0,0 +1,157 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVHAL project: https://github.com/nvitya/nvhal
+ * Copyright (c) 2020 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwprofile.cpp
+ *  brief:    Latency histograms, scope timers and named counters
+ *  version:  1.00
+ *  date:     2026-10-19
+ *  authors:  nvitya
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hwprofile.h"
+
+void THwHistogram::Reset()
+{
+	count = 0;
+	sum = 0;
+	minvalue = UINT64_MAX;
+	maxvalue = 0;
+	memset(&buckets[0], 0, sizeof(buckets));
+}
+
+void THwHistogram::Merge(const THwHistogram & aother)
+{
+	for (unsigned n = 0; n < HWPROF_BUCKETS; ++n)
+	{
+		buckets[n] += aother.buckets[n];
+	}
+	count += aother.count;
+	sum += aother.sum;
+	if (aother.minvalue < minvalue)  minvalue = aother.minvalue;
+	if (aother.maxvalue > maxvalue)  maxvalue = aother.maxvalue;
+}
+
+uint64_t THwHistogram::BucketLow(unsigned aidx)
+{
+	if (aidx < 2 * HWPROF_SUB_COUNT)
+	{
+		return aidx;
+	}
+	unsigned e = aidx / HWPROF_SUB_COUNT + HWPROF_SUB_BITS - 1;
+	unsigned sub = aidx % HWPROF_SUB_COUNT;
+	return uint64_t(HWPROF_SUB_COUNT + sub) << (e - HWPROF_SUB_BITS);
+}
+
+uint64_t THwHistogram::BucketHigh(unsigned aidx)
+{
+	if (aidx + 1 >= HWPROF_BUCKETS)
+	{
+		return UINT64_MAX;
+	}
+	return BucketLow(aidx + 1) - 1;
+}
+
+uint64_t THwHistogram::Percentile(double apercent)
+{
+	if (!count)
+	{
+		return 0;
+	}
+
+	uint64_t limit = uint64_t((apercent / 100.0) * double(count) + 0.5);
+	if (limit < 1)      limit = 1;
+	if (limit > count)  limit = count;
+
+	uint64_t cnt = 0;
+	for (unsigned n = 0; n < HWPROF_BUCKETS; ++n)
+	{
+		cnt += buckets[n];
+		if (cnt >= limit)
+		{
+			uint64_t result = BucketHigh(n);
+			return (result > maxvalue ? maxvalue : result);
+		}
+	}
+
+	return maxvalue;
+}
+
+void THwHistogram::Print(FILE * afile, const char * aname, unsigned avaluediv, const char * aunit)
+{
+	if (!avaluediv)  avaluediv = 1;
+
+	if (!count)
+	{
+		fprintf(afile, "%s: no samples\n", aname);
+		return;
+	}
+
+	fprintf(afile, "%s: %llu samples, min = %llu, avg = %llu, p50 = %llu, p99 = %llu, p99.9 = %llu, max = %llu %s\n",
+			aname, (unsigned long long)count,
+			(unsigned long long)(minvalue / avaluediv),
+			(unsigned long long)(Mean() / avaluediv),
+			(unsigned long long)(Percentile(50) / avaluediv),
+			(unsigned long long)(Percentile(99) / avaluediv),
+			(unsigned long long)(Percentile(99.9) / avaluediv),
+			(unsigned long long)(maxvalue / avaluediv),
+			aunit);
+}
+
+static THwCounter *  g_hwprof_counters = nullptr;
+
+THwCounter::THwCounter(const char * aname)
+{
+	name = aname;
+
+	// lock-free push, the counters might be constructed by more threads
+	next = __atomic_load_n(&g_hwprof_counters, __ATOMIC_ACQUIRE);
+	while (!__atomic_compare_exchange_n(&g_hwprof_counters, &next, this, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	{
+		// next was updated
+	}
+}
+
+THwCounter * hwprof_find_counter(const char * aname)
+{
+	THwCounter * cnt = __atomic_load_n(&g_hwprof_counters, __ATOMIC_ACQUIRE);
+	while (cnt)
+	{
+		if (strcmp(cnt->name, aname) == 0)
+		{
+			return cnt;
+		}
+		cnt = cnt->next;
+	}
+	return nullptr;
+}
+
+void hwprof_print_counters(FILE * afile)
+{
+	THwCounter * cnt = __atomic_load_n(&g_hwprof_counters, __ATOMIC_ACQUIRE);
+	while (cnt)
+	{
+		fprintf(afile, "%-32s %llu\n", cnt->name, (unsigned long long)cnt->Get());
+		cnt = cnt->next;
+	}
+}
@@ -0,0 +1,120 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVHAL project: https://github.com/nvitya/nvhal
+ * Copyright (c) 2020 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwprofile.h
+ *  brief:    Latency histograms, scope timers and named counters
+ *  version:  1.00
+ *  date:     2026-10-19
+ *  authors:  nvitya
+ *  notes:
+ *    The histogram buckets are log-linear: exact below 32, above that 16 buckets
+ *    for every power of 2, so the relative error is below 1/16 (6.25 %).
+ *    Nothing is allocated on the hot path. The histograms are not thread-safe,
+ *    use one per thread and Merge() them for the evaluation.
+*/
+
+#ifndef HWPROFILE_H_
+#define HWPROFILE_H_
+
+#include "platform.h"
+#include "stdio.h"
+#include "clockcnt.h"
+
+#define HWPROF_SUB_BITS   4
+#define HWPROF_SUB_COUNT  (1 << HWPROF_SUB_BITS)
+#define HWPROF_BUCKETS    ((64 - HWPROF_SUB_BITS + 1) * HWPROF_SUB_COUNT)
+
+class THwHistogram
+{
+public:
+	uint64_t     count = 0;
+	uint64_t     sum = 0;
+	uint64_t     minvalue = UINT64_MAX;
+	uint64_t     maxvalue = 0;
+	uint32_t     buckets[HWPROF_BUCKETS] = {0};
+
+	inline void Add(uint64_t avalue)
+	{
+		++buckets[BucketIndex(avalue)];
+		++count;
+		sum += avalue;
+		if (avalue < minvalue)  minvalue = avalue;
+		if (avalue > maxvalue)  maxvalue = avalue;
+	}
+
+	void         Reset();
+	void         Merge(const THwHistogram & aother);
+
+	uint64_t     Percentile(double apercent);  // highest value of the bucket, 0 when empty
+	uint64_t     Mean()  { return (count ? sum / count : 0); }
+
+	// avaluediv converts to the printed unit, e.g. CLOCKCNT_SPEED / 1000000 for us
+	void         Print(FILE * afile, const char * aname, unsigned avaluediv, const char * aunit);
+
+	static inline unsigned BucketIndex(uint64_t avalue)
+	{
+		if (avalue < 2 * HWPROF_SUB_COUNT)
+		{
+			return unsigned(avalue);
+		}
+		unsigned e = 63 - __builtin_clzll(avalue);
+		unsigned sub = unsigned(avalue >> (e - HWPROF_SUB_BITS)) & (HWPROF_SUB_COUNT - 1);
+		return (e - HWPROF_SUB_BITS + 1) * HWPROF_SUB_COUNT + sub;
+	}
+
+	static uint64_t BucketLow(unsigned aidx);
+	static uint64_t BucketHigh(unsigned aidx);
+};
+
+// measures the lifetime of the object in clocks into the histogram
+class THwScopeTimer
+{
+public:
+	THwHistogram *  histogram;
+	clockcnt_t      starttime;
+
+	THwScopeTimer(THwHistogram * ahistogram) : histogram(ahistogram), starttime(CLOCKCNT) { }
+	~THwScopeTimer() { histogram->Add(CLOCKCNT - starttime); }
+};
+
+#define HWPROF_CONCAT_(a, b)      a##b
+#define HWPROF_CONCAT(a, b)       HWPROF_CONCAT_(a, b)
+#define HWPROF_SCOPE(ahistogram)  THwScopeTimer HWPROF_CONCAT(hwprof_scope_timer_, __LINE__)(ahistogram)
+
+// named counter, declare these as static or global objects, they register themselves
+class THwCounter
+{
+public:
+	const char *    name;
+	uint64_t        value = 0;
+	THwCounter *    next = nullptr;
+
+	THwCounter(const char * aname);
+
+	inline void Inc(uint64_t an = 1)  { __atomic_fetch_add(&value, an, __ATOMIC_RELAXED); }
+	inline uint64_t Get()             { return __atomic_load_n(&value, __ATOMIC_RELAXED); }
+	inline void Reset()               { __atomic_store_n(&value, 0, __ATOMIC_RELAXED); }
+};
+
+THwCounter * hwprof_find_counter(const char * aname);
+void         hwprof_print_counters(FILE * afile);
+
+#endif /* HWPROFILE_H_ */
@@ -0,0 +1,109 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVHAL project: https://github.com/nvitya/nvhal
+ * Copyright (c) 2020 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwtrace.cpp
+ *  brief:    Timestamped trace ring for the driver events
+ *  version:  1.00
+ *  date:     2026-10-19
+ *  authors:  nvitya
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "hwtrace.h"
+
+thread_local THwTraceRing *  g_hwtrace_ring = nullptr;
+
+static THwTraceRing *  g_hwtrace_rings = nullptr;  // never freed, the dump needs the rings of the ended threads too
+
+THwTraceRing * hwtrace_thread_ring()
+{
+	if (!g_hwtrace_ring)
+	{
+		THwTraceRing * ring = (THwTraceRing *)calloc(1, sizeof(THwTraceRing));
+		if (!ring)
+		{
+			return nullptr;
+		}
+
+		ring->tid = syscall(SYS_gettid);
+
+		// lock-free push to the list
+		ring->next = __atomic_load_n(&g_hwtrace_rings, __ATOMIC_ACQUIRE);
+		while (!__atomic_compare_exchange_n(&g_hwtrace_rings, &ring->next, ring, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+		{
+			// ring->next was updated
+		}
+
+		g_hwtrace_ring = ring;
+	}
+
+	return g_hwtrace_ring;
+}
+
+const char * hwtrace_event_name(uint32_t aevent)
+{
+	switch (aevent)
+	{
+		case HWTR_DMA_PREPARE:        return "DMA_PREPARE";
+		case HWTR_UART_DMA_TX:        return "UART_DMA_TX";
+		case HWTR_UART_DMA_RX:        return "UART_DMA_RX";
+		case HWTR_PIN_SETUP:          return "PIN_SETUP";
+		case HWTR_UART_TX_STALL:      return "UART_TX_STALL";
+		case HWTR_UART_TX_STALL_END:  return "UART_TX_STALL_END";
+		default:                      return (aevent >= HWTR_USER ? "USER" : "?");
+	}
+}
+
+void hwtrace_dump(FILE * afile)
+{
+	THwTraceRing * ring = __atomic_load_n(&g_hwtrace_rings, __ATOMIC_ACQUIRE);
+	while (ring)
+	{
+		uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		uint32_t first = (head > HWTRACE_RING_SIZE ? head - HWTRACE_RING_SIZE : 0);
+
+		fprintf(afile, "thread %i: %u events, %u lost\n", ring->tid, head - first, first);
+
+		for (uint32_t n = first; n < head; ++n)
+		{
+			THwTraceRecord * rec = &ring->records[n & (HWTRACE_RING_SIZE - 1)];
+			fprintf(afile, "  %14llu  %-18s %4u  %08X %08X\n", (unsigned long long)rec->time,
+					hwtrace_event_name(rec->event), rec->event, rec->arg1, rec->arg2);
+		}
+
+		ring = ring->next;
+	}
+}
+
+void hwtrace_clear()
+{
+	THwTraceRing * ring = __atomic_load_n(&g_hwtrace_rings, __ATOMIC_ACQUIRE);
+	while (ring)
+	{
+		__atomic_store_n(&ring->head, 0, __ATOMIC_RELEASE);
+		ring = ring->next;
+	}
+}
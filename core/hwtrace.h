@@ -0,0 +1,108 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVHAL project: https://github.com/nvitya/nvhal
+ * Copyright (c) 2020 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwtrace.h
+ *  brief:    Timestamped trace ring for the driver events
+ *  version:  1.00
+ *  date:     2026-10-19
+ *  authors:  nvitya
+ *  notes:
+ *    Enable with "#define HWTRACE_ENABLED 1" in the board.h, otherwise the HWTRACE()
+ *    calls are compiled out. Every thread writes its own ring without locking,
+ *    the oldest records are overwritten. hwtrace_dump() prints all the rings.
+*/
+
+#ifndef HWTRACE_H_
+#define HWTRACE_H_
+
+#include "platform.h"
+#include "stdio.h"
+#include "clockcnt.h"
+
+#ifndef HWTRACE_ENABLED
+  #define HWTRACE_ENABLED  0
+#endif
+
+#ifndef HWTRACE_RING_SIZE
+  #define HWTRACE_RING_SIZE  1024  // records per thread, must be a power of 2
+#endif
+
+// event ids
+
+#define HWTR_DMA_PREPARE        1  // arg1: channel, arg2: transfer flags
+#define HWTR_UART_DMA_TX        2  // arg1: uart, arg2: bytes
+#define HWTR_UART_DMA_RX        3  // arg1: uart, arg2: bytes
+#define HWTR_PIN_SETUP          4  // arg1: pin, arg2: flags
+#define HWTR_UART_TX_STALL      5  // arg1: uart, the TX FIFO is full
+#define HWTR_UART_TX_STALL_END  6  // arg1: uart, arg2: stall time in clocks
+
+#define HWTR_USER            0x100  // the application events start here
+
+struct THwTraceRecord  // 24 bytes
+{
+	clockcnt_t    time;
+	uint32_t      event;
+	uint32_t      arg1;
+	uint32_t      arg2;
+	uint32_t      _reserved;
+};
+
+struct THwTraceRing
+{
+	THwTraceRing *   next;       // list of all the rings for the dump
+	int              tid;
+	uint32_t         head;       // total records written
+	THwTraceRecord   records[HWTRACE_RING_SIZE];
+};
+
+extern thread_local THwTraceRing *  g_hwtrace_ring;
+
+THwTraceRing * hwtrace_thread_ring();  // allocates the ring of the calling thread
+
+inline void hwtrace_emit(uint32_t aevent, uint32_t aarg1, uint32_t aarg2)
+{
+	THwTraceRing * ring = g_hwtrace_ring;
+	if (!ring)
+	{
+		ring = hwtrace_thread_ring();
+		if (!ring)  return;
+	}
+
+	uint32_t idx = ring->head;
+	THwTraceRecord * rec = &ring->records[idx & (HWTRACE_RING_SIZE - 1)];
+	rec->time = CLOCKCNT;
+	rec->event = aevent;
+	rec->arg1 = aarg1;
+	rec->arg2 = aarg2;
+	__atomic_store_n(&ring->head, idx + 1, __ATOMIC_RELEASE);
+}
+
+const char * hwtrace_event_name(uint32_t aevent);
+void hwtrace_dump(FILE * afile);  // best when the traced threads are stopped
+void hwtrace_clear();
+
+#if HWTRACE_ENABLED
+  #define HWTRACE(aevent, aarg1, aarg2)  hwtrace_emit(aevent, aarg1, aarg2)
+#else
+  #define HWTRACE(aevent, aarg1, aarg2)  ((void)0)
+#endif
+
+#endif /* HWTRACE_H_ */
@@ -77,3 +77,72 @@ bool THwUart::DmaRecvCompleted()
 	return true;
 }
 
+unsigned THwUart::DmaRecvPosition()
+{
+	if (!rxdma || !rxdma_length)
+	{
+		return 0;
+	}
+
+	unsigned remaining = rxdma->Remaining();
+	if (remaining > rxdma_length)
+	{
+		return 0;
+	}
+
+	unsigned pos = rxdma_length - remaining;
+	if (rxdma_circular && (pos >= rxdma_length))
+	{
+		pos = 0;
+	}
+
+	return pos;
+}
+
+bool THwUart::DmaRecvIdle(unsigned * rpacketend)
+{
+	// The packet end is detected when the DMA write position did not change
+	// for rxidle_bits time or the UART signals the receive timeout (32 bit times idle
+	// with data in the RX FIFO), whichever comes first.
+
+	unsigned   pos = DmaRecvPosition();
+	clockcnt_t t = CLOCKCNT;
+	bool       rxtimeout = RecvTimeout();
+
+	if (pos != rxidle_lastpos)
+	{
+		rxidle_lastpos = pos;
+		rxidle_lastchange = t;
+		if (!rxtimeout)
+		{
+			return false;
+		}
+	}
+
+	if (pos == rxidle_packetpos)
+	{
+		return false;  // no new data since the last packet end
+	}
+
+	if (!rxtimeout)
+	{
+		clockcnt_t idleclocks = (clockcnt_t(rxidle_bits) * CLOCKCNT_SPEED) / baudrate;
+		if (t - rxidle_lastchange < idleclocks)
+		{
+			return false;
+		}
+	}
+
+	if (pos > rxidle_packetpos)
+	{
+		stats.bytes_in += pos - rxidle_packetpos;
+	}
+	else
+	{
+		stats.bytes_in += rxdma_length - rxidle_packetpos + pos;
+	}
+
+	rxidle_packetpos = pos;
+	*rpacketend = pos;
+	return true;
+}
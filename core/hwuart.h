@@ -31,9 +31,25 @@
 
 #include "platform.h"
 #include "hwdma.h"
+#include "clockcnt.h"
+#include "hwtrace.h"
 
 #define FMT_BUFFER_SIZE  256
 
+struct THwUartStats
+{
+	uint64_t   bytes_out;
+	uint64_t   bytes_in;
+	uint32_t   rxfifo_hwm;      // most chars read in one run, approximates the highest RX FIFO fill
+	uint32_t   txfifo_full;     // SendChar() had to wait for the TX FIFO
+	uint32_t   overruns;
+	uint32_t   framing_errors;
+	uint32_t   parity_errors;
+	uint32_t   breaks;
+	uint32_t   dma_tx_starts;
+	uint32_t   dma_rx_starts;
+};
+
 class THwUart_pre
 {
 public:
@@ -46,10 +62,24 @@ public:
 	int     halfstopbits = 2;
 	bool    parity = false;
 	bool    oddparity = false;
+	bool    hwflowctrl = false;  // RTS/CTS hardware flow control
+
+	THwUartStats         stats = {};
 
 public:  // DMA
 	THwDmaChannel *      txdma = nullptr;
 	THwDmaChannel *      rxdma = nullptr;
+
+public:  // DMA receive packet framing
+	unsigned             rxdma_length = 0;  // bytes of the running RX DMA transfer
+	bool                 rxdma_circular = false;
+	unsigned             rxidle_bits = 32;  // line idle time that closes a packet (bit times)
+
+protected:
+	unsigned             rxburst = 0;
+	unsigned             rxidle_lastpos = 0;
+	unsigned             rxidle_packetpos = 0;
+	clockcnt_t           rxidle_lastchange = 0;
 };
 
 #endif // ndef HWUART_H_PRE_
@@ -75,6 +105,8 @@ public: // mandatory
 	bool TrySendChar(char ach)    { return false; }
 	bool TryRecvChar(char * ach)  { return false; }
 	bool SendFinished()           { return true; }
+	bool RecvTimeout()            { return false; }
+	void CheckLineStatus()        { }
 
 	void DmaAssign(bool istx, THwDmaChannel * admach)  { }
 
@@ -92,11 +124,28 @@ class THwUart : public HWUART_IMPL
 {
 public:
 
-	void SendChar(char ach) { while (!TrySendChar(ach)) {} }
+	void SendChar(char ach)
+	{
+		if (!TrySendChar(ach))
+		{
+			++stats.txfifo_full;
+#if HWTRACE_ENABLED
+			clockcnt_t t0 = CLOCKCNT;
+			HWTRACE(HWTR_UART_TX_STALL, devnum, 0);
+#endif
+			while (!TrySendChar(ach)) {}
+			HWTRACE(HWTR_UART_TX_STALL_END, devnum, uint32_t(CLOCKCNT - t0));
+		}
+	}
+
+	void ResetStats()  { stats = {}; }
 
 	bool DmaSendCompleted();
 	bool DmaRecvCompleted();
 
+	unsigned DmaRecvPosition();  // current write offset of the RX DMA
+	bool DmaRecvIdle(unsigned * rpacketend);  // true once after every packet, rpacketend = end offset
+
 	void printf(const char * fmt, ...);
 };
 
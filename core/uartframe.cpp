@@ -0,0 +1,302 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVHAL project: https://github.com/nvitya/nvhal
+ * Copyright (c) 2020 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     uartframe.cpp
+ *  brief:    COBS / SLIP packet framing over UART DMA
+ *  version:  1.00
+ *  date:     2026-10-19
+ *  authors:  nvitya
+ *  notes:
+ *    The source is scanned word-at-a-time for the special bytes. The output is written
+ *    byte-by-byte, because the uncached DMA memory does not tolerate unaligned accesses.
+*/
+
+#include "string.h"
+#include "platform.h"
+#include "uartframe.h"
+
+static inline uint32_t word_has_zero_byte(uint32_t v)
+{
+	return ((v - 0x01010101u) & ~v & 0x80808080u);
+}
+
+// returns the number of non-zero bytes at the start of the src
+static unsigned nonzero_run(const uint8_t * src, unsigned maxlen)
+{
+	unsigned i = 0;
+	uint32_t v;
+
+	while (i + 4 <= maxlen)
+	{
+		memcpy(&v, src + i, 4);
+		if (word_has_zero_byte(v))
+		{
+			break;
+		}
+		i += 4;
+	}
+
+	while ((i < maxlen) && src[i])
+	{
+		++i;
+	}
+
+	return i;
+}
+
+// returns the number of bytes at the start of the src which need no SLIP escaping
+static unsigned slip_plain_run(const uint8_t * src, unsigned maxlen)
+{
+	unsigned i = 0;
+	uint32_t v;
+
+	while (i + 4 <= maxlen)
+	{
+		memcpy(&v, src + i, 4);
+		if (word_has_zero_byte(v ^ 0xC0C0C0C0u) | word_has_zero_byte(v ^ 0xDBDBDBDBu))
+		{
+			break;
+		}
+		i += 4;
+	}
+
+	while ((i < maxlen) && (src[i] != SLIP_END) && (src[i] != SLIP_ESC))
+	{
+		++i;
+	}
+
+	return i;
+}
+
+unsigned cobs_encode_frame(uint8_t * dst, unsigned dstlen, const void * src, unsigned srclen)
+{
+	if (dstlen < COBS_MAX_FRAME_LEN(srclen))
+	{
+		return 0;
+	}
+
+	const uint8_t * sp = (const uint8_t *)src;
+	const uint8_t * endp = sp + srclen;
+	unsigned codeidx = 0;
+	unsigned di = 1;
+
+	while (true)
+	{
+		unsigned n = endp - sp;
+		if (n > 254)  n = 254;
+
+		unsigned run = nonzero_run(sp, n);
+		for (unsigned i = 0; i < run; ++i)
+		{
+			dst[di++] = sp[i];
+		}
+		sp += run;
+
+		if (sp >= endp)
+		{
+			dst[codeidx] = run + 1;
+			break;
+		}
+
+		if (254 == run)  // full block without zero
+		{
+			dst[codeidx] = 0xFF;
+		}
+		else // zero byte
+		{
+			dst[codeidx] = run + 1;
+			++sp;
+		}
+		codeidx = di++;
+	}
+
+	dst[di++] = 0;  // frame delimiter
+	return di;
+}
+
+unsigned slip_encode_frame(uint8_t * dst, unsigned dstlen, const void * src, unsigned srclen)
+{
+	if (dstlen < SLIP_MAX_FRAME_LEN(srclen))
+	{
+		return 0;
+	}
+
+	const uint8_t * sp = (const uint8_t *)src;
+	const uint8_t * endp = sp + srclen;
+	unsigned di = 0;
+
+	dst[di++] = SLIP_END;  // flushes the line noise at the receiver
+
+	while (sp < endp)
+	{
+		unsigned run = slip_plain_run(sp, endp - sp);
+		for (unsigned i = 0; i < run; ++i)
+		{
+			dst[di++] = sp[i];
+		}
+		sp += run;
+
+		if (sp < endp)
+		{
+			dst[di++] = SLIP_ESC;
+			dst[di++] = (SLIP_END == *sp ? SLIP_ESC_END : SLIP_ESC_ESC);
+			++sp;
+		}
+	}
+
+	dst[di++] = SLIP_END;
+	return di;
+}
+
+//-----------------------------------------------------------------------------
+
+void TFrameDecoder::Start(unsigned amode, uint8_t * adst, unsigned amaxlen)
+{
+	mode = amode;
+	dst = adst;
+	maxlen = amaxlen;
+	len = 0;
+	error = false;
+	remaining = 0;
+	zeropending = false;
+	escape = false;
+}
+
+void TFrameDecoder::Feed(const uint8_t * src, unsigned srclen)
+{
+	while (srclen)
+	{
+		PutByte(*src);
+		++src;
+		--srclen;
+	}
+}
+
+int TFrameDecoder::Finish()
+{
+	if (error || remaining || escape)
+	{
+		return -1;
+	}
+
+	return len;
+}
+
+//-----------------------------------------------------------------------------
+
+bool TUartFramer::Init(THwUart * auart, unsigned amode, uint8_t * atxbuf, unsigned atxbufsize,
+                       uint8_t * arxbuf, unsigned arxbufsize, uint8_t * arxpacket, unsigned arxpacketsize)
+{
+	uart = auart;
+	mode = amode;
+	txbuf = atxbuf;
+	txbufsize = atxbufsize;
+	rxbuf = arxbuf;
+	rxbufsize = arxbufsize;
+	rxpacket = arxpacket;
+	rxpacketsize = arxpacketsize;
+
+	rxpos = 0;
+	frame_errors = 0;
+	delimiter = (UFRM_COBS == mode ? 0 : SLIP_END);
+	decoder.Start(mode, rxpacket, rxpacketsize);
+
+	if (!uart || !uart->txdma || !uart->rxdma || !txbuf || !rxbuf || !rxpacket)
+	{
+		return false;
+	}
+
+	rxfer.srcaddr = nullptr;
+	rxfer.dstaddr = rxbuf;
+	rxfer.bytewidth = 1;
+	rxfer.count = rxbufsize;
+	rxfer.flags = DMATR_CIRCULAR;
+
+	return uart->DmaStartRecv(&rxfer);
+}
+
+bool TUartFramer::SendPacket(const void * adata, unsigned alen)
+{
+	if (!uart->DmaSendCompleted())
+	{
+		return false;
+	}
+
+	unsigned framelen;
+	if (UFRM_COBS == mode)
+	{
+		framelen = cobs_encode_frame(txbuf, txbufsize, adata, alen);
+	}
+	else
+	{
+		framelen = slip_encode_frame(txbuf, txbufsize, adata, alen);
+	}
+
+	if (!framelen)
+	{
+		return false;
+	}
+
+	txfer.srcaddr = txbuf;
+	txfer.dstaddr = nullptr;
+	txfer.bytewidth = 1;
+	txfer.count = framelen;
+	txfer.flags = 0;
+
+	return uart->DmaStartSend(&txfer);
+}
+
+uint8_t * TUartFramer::RecvPacket(unsigned * rlen)
+{
+	unsigned wrpos = uart->DmaRecvPosition();
+
+	while (rxpos != wrpos)
+	{
+		uint8_t b = rxbuf[rxpos];
+		if (++rxpos >= rxbufsize)  rxpos = 0;
+
+		if (b != delimiter)
+		{
+			decoder.PutByte(b);
+			continue;
+		}
+
+		if ((0 == decoder.len) && !decoder.error && (UFRM_SLIP == mode))
+		{
+			continue;  // empty SLIP frame (leading END)
+		}
+
+		int r = decoder.Finish();
+		decoder.Restart();
+
+		if (r > 0)
+		{
+			*rlen = r;
+			return rxpacket;
+		}
+		else if (r < 0)
+		{
+			++frame_errors;
+		}
+	}
+
+	return nullptr;
+}
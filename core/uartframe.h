@@ -0,0 +1,157 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVHAL project: https://github.com/nvitya/nvhal
+ * Copyright (c) 2020 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     uartframe.h
+ *  brief:    COBS / SLIP packet framing over UART DMA
+ *  version:  1.00
+ *  date:     2026-10-19
+ *  authors:  nvitya
+ *  notes:
+ *    The packets are encoded directly into the (uncached) TX DMA buffer and decoded
+ *    in one pass from the circular RX DMA buffer, there is no intermediate copy.
+*/
+
+#ifndef UARTFRAME_H_
+#define UARTFRAME_H_
+
+#include "platform.h"
+#include "hwuart.h"
+
+#define UFRM_COBS   0  // Consistent Overhead Byte Stuffing, 0x00 frame delimiter
+#define UFRM_SLIP   1  // RFC 1055, 0xC0 frame delimiter
+
+#define SLIP_END       0xC0
+#define SLIP_ESC       0xDB
+#define SLIP_ESC_END   0xDC
+#define SLIP_ESC_ESC   0xDD
+
+// worst case encoded sizes including the frame delimiter(s)
+#define COBS_MAX_FRAME_LEN(n)  ((n) + ((n) / 254) + 2)
+#define SLIP_MAX_FRAME_LEN(n)  (2 * (n) + 2)
+
+// Encoders, they return the frame length with the delimiter(s), 0 if the frame does not fit
+unsigned cobs_encode_frame(uint8_t * dst, unsigned dstlen, const void * src, unsigned srclen);
+unsigned slip_encode_frame(uint8_t * dst, unsigned dstlen, const void * src, unsigned srclen);
+
+class TFrameDecoder  // incremental decoder, the frame content can be fed in any pieces
+{
+public:
+	unsigned       mode = UFRM_COBS;
+	uint8_t *      dst = nullptr;
+	unsigned       maxlen = 0;
+	unsigned       len = 0;
+	bool           error = false;
+
+	void Start(unsigned amode, uint8_t * adst, unsigned amaxlen);
+	void Restart()  { Start(mode, dst, maxlen); }
+
+	int  Finish();  // returns the decoded length or -1 on error
+
+	inline void PutByte(uint8_t b)  // b must not be the frame delimiter
+	{
+		if (UFRM_COBS == mode)
+		{
+			if (remaining)
+			{
+				--remaining;
+				Output(b);
+			}
+			else // code byte
+			{
+				if (zeropending)  Output(0);
+				remaining = b - 1;
+				zeropending = (b != 0xFF);
+			}
+		}
+		else
+		{
+			if (escape)
+			{
+				escape = false;
+				if      (SLIP_ESC_END == b)  Output(SLIP_END);
+				else if (SLIP_ESC_ESC == b)  Output(SLIP_ESC);
+				else                         error = true;
+			}
+			else if (SLIP_ESC == b)
+			{
+				escape = true;
+			}
+			else
+			{
+				Output(b);
+			}
+		}
+	}
+
+	void Feed(const uint8_t * src, unsigned srclen);
+
+protected:
+	unsigned       remaining = 0;
+	bool           zeropending = false;
+	bool           escape = false;
+
+	inline void Output(uint8_t b)
+	{
+		if (len < maxlen)
+		{
+			dst[len++] = b;
+		}
+		else
+		{
+			error = true;
+		}
+	}
+};
+
+class TUartFramer
+{
+public:
+	THwUart *          uart = nullptr;
+	unsigned           mode = UFRM_COBS;
+
+	uint8_t *          txbuf = nullptr;     // DMA buffer, e.g. from hwdma_allocate_dma_buffer()
+	unsigned           txbufsize = 0;
+	uint8_t *          rxbuf = nullptr;     // DMA buffer for the circular receive
+	unsigned           rxbufsize = 0;
+	uint8_t *          rxpacket = nullptr;  // decoded packet (normal memory)
+	unsigned           rxpacketsize = 0;
+
+	unsigned           rxpos = 0;           // read position in the rxbuf
+	unsigned           frame_errors = 0;
+
+	// the UART must have both TX and RX DMA assigned, starts the circular receive
+	bool Init(THwUart * auart, unsigned amode, uint8_t * atxbuf, unsigned atxbufsize,
+	          uint8_t * arxbuf, unsigned arxbufsize, uint8_t * arxpacket, unsigned arxpacketsize);
+
+	bool SendPacket(const void * adata, unsigned alen);  // false = TX busy or too long
+	bool SendFinished()  { return uart->DmaSendCompleted(); }
+
+	// returns the next received packet (valid until the next call) or nullptr
+	uint8_t * RecvPacket(unsigned * rlen);
+
+protected:
+	uint8_t            delimiter = 0;
+	TFrameDecoder      decoder;
+	THwDmaTransfer     txfer;
+	THwDmaTransfer     rxfer;
+};
+
+#endif /* UARTFRAME_H_ */
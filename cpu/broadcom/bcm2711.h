@@ -31,6 +31,10 @@
 
 // peripheral addresses (for hw_memmap), for the bus address apply 0x7FFFFFFF mask
 
+// mapped once by hw_memmap() for all the peripherals inside
+#define HW_PERIPH_WINDOW_BASE 0xFE000000
+#define HW_PERIPH_WINDOW_SIZE 0x01800000
+
 #define SYSTEM_TIMER_BASE     0xFE003000
 #define HW_GPIO_BASE          0xFE200000  // different than in the documentation (0xFE21500)
 
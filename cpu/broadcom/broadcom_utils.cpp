@@ -37,6 +37,8 @@
 #include <sys/mman.h>
 #include <sys/ioctl.h>
 
+#include "broadcom_utils.h"
+
 #define MEM_FLAG_DIRECT           (1 << 2)
 #define MEM_FLAG_COHERENT         (2 << 2)
 #define MEM_FLAG_L1_NONALLOCATING (MEM_FLAG_DIRECT | MEM_FLAG_COHERENT)
@@ -78,108 +80,207 @@ bool broadcom_vpu_mbox_cmd(unsigned * buf)
   return true;
 }
 
-unsigned broadcom_vpu_mem_alloc(unsigned size)
+int TVpuPropertyMsg::AddTag(unsigned atag, unsigned areqwords, const unsigned * areqdata, unsigned arespwords)
+{
+	unsigned valwords = (areqwords > arespwords ? areqwords : arespwords);
+	if (length + 3 + valwords + 1 > VPU_PROP_MAX_WORDS)  // keep place for the end tag
+	{
+		return -1;
+	}
+
+	int result = length;
+	buf[length++] = atag;
+	buf[length++] = valwords * 4;  // size of the value buffer
+	buf[length++] = areqwords * 4; // request code: size of the request data
+	for (unsigned n = 0; n < valwords; ++n)
+	{
+		buf[length++] = (n < areqwords ? areqdata[n] : 0);
+	}
+
+	return result;
+}
+
+bool TVpuPropertyMsg::Execute()
 {
-   int i=0;
-   unsigned p[32];
-   p[i++] = 0; // size
-   p[i++] = 0x00000000; // process request
+	buf[0] = (length + 1) * 4;  // actual size
+	buf[1] = 0x00000000;        // process request
+	buf[length] = 0x00000000;   // end tag
 
-   p[i++] = 0x3000c; // (the tag id)
-   p[i++] = 12; // (size of the buffer)
-   p[i++] = 12; // (size of the data)
-   p[i++] = size; // (num bytes? or pages?)
-   p[i++] = 4096; // (alignment)
-   p[i++] = MEM_FLAG_L1_NONALLOCATING; // flags
+	if (!broadcom_vpu_mbox_cmd(&buf[0]))
+	{
+		return false;
+	}
 
-   p[i++] = 0x00000000; // end tag
-   p[0] = i * sizeof(p[0]); // actual size
+	return (buf[1] == 0x80000000);  // request successful
+}
 
-   if (broadcom_vpu_mbox_cmd(p))
-   {
-     return p[5];
-   }
-   else
-   {
-     printf("broadcom_vpu_mem_alloc error\n");
-  	 return 0;
-   }
+bool TVpuPropertyMsg::TagOk(int atagidx)
+{
+	return (atagidx >= 0) && (buf[atagidx + 2] & 0x80000000);
 }
 
-unsigned broadcom_vpu_mem_free(unsigned handle)
+unsigned TVpuPropertyMsg::TagValue(int atagidx, unsigned awordidx)
 {
-   int i=0;
-   unsigned p[32];
-   p[i++] = 0; // size
-   p[i++] = 0x00000000; // process request
+	if ((atagidx < 0) || (awordidx * 4 >= buf[atagidx + 1]))
+	{
+		return 0;
+	}
+	return buf[atagidx + 3 + awordidx];
+}
 
-   p[i++] = 0x3000f; // (the tag id)
-   p[i++] = 4; // (size of the buffer)
-   p[i++] = 4; // (size of the data)
-   p[i++] = handle;
+// the lock needs the handle from the alloc, so these can not be batched
 
-   p[i++] = 0x00000000; // end tag
-   p[0] = i * sizeof(p[0]); // actual size
+unsigned broadcom_vpu_mem_alloc(unsigned size)
+{
+	TVpuPropertyMsg msg;
+	unsigned req[3] = { size, 4096, MEM_FLAG_L1_NONALLOCATING };  // size, alignment, flags
+	int tag = msg.AddTag(0x3000c, 3, &req[0], 1);
 
-   if (broadcom_vpu_mbox_cmd(p))
-   {
-     return p[5];
-   }
-   else
-   {
-     printf("broadcom_vpu_mem_free error\n");
-  	 return 0;
-   }
+	if (msg.Execute() && msg.TagOk(tag))
+	{
+		return msg.TagValue(tag);
+	}
+	else
+	{
+		printf("broadcom_vpu_mem_alloc error\n");
+		return 0;
+	}
 }
 
-unsigned broadcom_vpu_mem_lock(unsigned handle)
+unsigned broadcom_vpu_mem_free(unsigned handle)
 {
-   int i=0;
-   unsigned p[32];
-   p[i++] = 0; // size
-   p[i++] = 0x00000000; // process request
+	TVpuPropertyMsg msg;
+	int tag = msg.AddTag(0x3000f, handle);
 
-   p[i++] = 0x3000d; // (the tag id)
-   p[i++] = 4; // (size of the buffer)
-   p[i++] = 4; // (size of the data)
-   p[i++] = handle;
+	if (msg.Execute() && msg.TagOk(tag))
+	{
+		return msg.TagValue(tag);
+	}
+	else
+	{
+		printf("broadcom_vpu_mem_free error\n");
+		return 0;
+	}
+}
 
-   p[i++] = 0x00000000; // end tag
-   p[0] = i * sizeof(p[0]); // actual size
+unsigned broadcom_vpu_mem_lock(unsigned handle)
+{
+	TVpuPropertyMsg msg;
+	int tag = msg.AddTag(0x3000d, handle);
 
-   if (broadcom_vpu_mbox_cmd(p))
-   {
-     return p[5];
-   }
-   else
-   {
-     printf("broadcom_vpu_mem_lock error\n");
-  	 return 0;
-   }
+	if (msg.Execute() && msg.TagOk(tag))
+	{
+		return msg.TagValue(tag);
+	}
+	else
+	{
+		printf("broadcom_vpu_mem_lock error\n");
+		return 0;
+	}
 }
 
 unsigned broadcom_vpu_mem_unlock(unsigned handle)
 {
-   int i=0;
-   unsigned p[32];
-   p[i++] = 0; // size
-   p[i++] = 0x00000000; // process request
-
-   p[i++] = 0x3000e; // (the tag id)
-   p[i++] = 4; // (size of the buffer)
-   p[i++] = 4; // (size of the data)
-   p[i++] = handle;
-
-   p[i++] = 0x00000000; // end tag
-   p[0] = i*sizeof *p; // actual size
-
-   if (broadcom_vpu_mbox_cmd(p))
-   {
-     return p[5];
-   }
-   else
-   {
-     printf("broadcom_vpu_mem_unlock error\n");
-  	 return 0;
-   }
+	TVpuPropertyMsg msg;
+	int tag = msg.AddTag(0x3000e, handle);
+
+	if (msg.Execute() && msg.TagOk(tag))
+	{
+		return msg.TagValue(tag);
+	}
+	else
+	{
+		printf("broadcom_vpu_mem_unlock error\n");
+		return 0;
+	}
+}
+
+bool broadcom_vpu_mem_unlock_free(unsigned handle)
+{
+	TVpuPropertyMsg msg;
+	int tagunlock = msg.AddTag(0x3000e, handle);
+	int tagfree = msg.AddTag(0x3000f, handle);
+
+	if (msg.Execute() && msg.TagOk(tagunlock) && msg.TagOk(tagfree))
+	{
+		return (0 == msg.TagValue(tagfree));  // status: 0 = success
+	}
+	else
+	{
+		printf("broadcom_vpu_mem_unlock_free error\n");
+		return false;
+	}
+}
+
+unsigned broadcom_vpu_get_dma_channels()
+{
+	TVpuPropertyMsg msg;
+	int tag = msg.AddTag(0x60001, 0, nullptr, 1);
+
+	if (msg.Execute() && msg.TagOk(tag))
+	{
+		return msg.TagValue(tag);
+	}
+	else
+	{
+		printf("broadcom_vpu_get_dma_channels error\n");
+		return 0;
+	}
+}
+
+unsigned broadcom_vpu_get_clock_rate(unsigned aclockid)
+{
+	TVpuPropertyMsg msg;
+	int tag = msg.AddTag(0x30047, aclockid, 2);  // get clock rate measured
+
+	if (msg.Execute() && msg.TagOk(tag))
+	{
+		return msg.TagValue(tag, 1);  // clock id, rate
+	}
+	else
+	{
+		printf("broadcom_vpu_get_clock_rate error\n");
+		return 0;
+	}
+}
+
+unsigned       g_vpu_telemetry_interval_us = 1000000;
+TVpuTelemetry  g_vpu_telemetry = {};
+
+bool broadcom_vpu_refresh_telemetry()
+{
+	TVpuPropertyMsg msg;
+	int tagarm = msg.AddTag(0x30002, VPU_CLOCK_ARM, 2);  // get clock rate
+	int tagcore = msg.AddTag(0x30002, VPU_CLOCK_CORE, 2);
+	int taguart = msg.AddTag(0x30002, VPU_CLOCK_UART, 2);
+	int tagtemp = msg.AddTag(0x30006, 0, 2);  // get temperature of sensor 0
+	int tagthr = msg.AddTag(0x30046, 0, 1);   // get throttled, 0 = do not clear the sticky bits
+
+	g_vpu_telemetry.updated = CLOCKCNT;
+
+	if (!msg.Execute())
+	{
+		g_vpu_telemetry.valid = false;
+		return false;
+	}
+
+	g_vpu_telemetry.arm_clock = (msg.TagOk(tagarm) ? msg.TagValue(tagarm, 1) : 0);
+	g_vpu_telemetry.core_clock = (msg.TagOk(tagcore) ? msg.TagValue(tagcore, 1) : 0);
+	g_vpu_telemetry.uart_clock = (msg.TagOk(taguart) ? msg.TagValue(taguart, 1) : 0);
+	g_vpu_telemetry.temperature = (msg.TagOk(tagtemp) ? int(msg.TagValue(tagtemp, 1)) : 0);
+	g_vpu_telemetry.throttled = (msg.TagOk(tagthr) ? msg.TagValue(tagthr) : 0);
+	g_vpu_telemetry.valid = true;
+
+	return true;
+}
+
+TVpuTelemetry * broadcom_vpu_telemetry()
+{
+	clockcnt_t maxage = clockcnt_t(g_vpu_telemetry_interval_us) * (CLOCKCNT_SPEED / 1000000);
+	if ((0 == g_vpu_telemetry.updated) || (CLOCKCNT - g_vpu_telemetry.updated >= maxage))
+	{
+		broadcom_vpu_refresh_telemetry();
+	}
+
+	return &g_vpu_telemetry;
 }
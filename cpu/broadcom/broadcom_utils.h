@@ -26,14 +26,74 @@
  *  authors:  nvitya
  *  notes:
  *    Uncached memory allocation using the VPU
+ *    The property tags can be batched into one mailbox call with TVpuPropertyMsg
+ *    Clock, temperature and throttling telemetry without vcgencmd
 */
 
 #ifndef BROADCOM_UTILS_H_
 #define BROADCOM_UTILS_H_
 
+#include "clockcnt.h"
+
+#define VPU_PROP_MAX_WORDS  256
+
+class TVpuPropertyMsg
+{
+public:
+	unsigned      buf[VPU_PROP_MAX_WORDS] __attribute__((aligned(16)));
+	unsigned      length = 2;  // in words, the size and request code
+
+	void          Reset() { length = 2; }
+
+	// returns the tag index for the response accessors, -1 when the buffer is full
+	// the value buffer is sized for the larger of the request and the response
+	int           AddTag(unsigned atag, unsigned areqwords, const unsigned * areqdata, unsigned arespwords);
+	int           AddTag(unsigned atag, unsigned avalue, unsigned arespwords = 1)  { return AddTag(atag, 1, &avalue, arespwords); }
+
+	bool          Execute();  // one mailbox call for all the tags
+
+	bool          TagOk(int atagidx);  // the firmware processed the tag
+	unsigned      TagValue(int atagidx, unsigned awordidx = 0);
+};
+
+bool     broadcom_vpu_mbox_cmd(unsigned * buf);
+
 unsigned broadcom_vpu_mem_alloc(unsigned size);
 unsigned broadcom_vpu_mem_free(unsigned handle);
 unsigned broadcom_vpu_mem_lock(unsigned handle);
 unsigned broadcom_vpu_mem_unlock(unsigned handle);
+bool     broadcom_vpu_mem_unlock_free(unsigned handle);  // unlock and free in one mailbox call
+
+unsigned broadcom_vpu_get_dma_channels();  // mask of the DMA channels usable by the ARM, 0 = error
+
+// firmware telemetry
+
+#define VPU_CLOCK_UART   2
+#define VPU_CLOCK_ARM    3
+#define VPU_CLOCK_CORE   4
+
+// throttled flags, the lower bits are the actual state, the upper ones are sticky
+#define VPU_THROTTLED_UNDERVOLTAGE       0x00001
+#define VPU_THROTTLED_FREQ_CAPPED        0x00002
+#define VPU_THROTTLED_THROTTLED          0x00004
+#define VPU_THROTTLED_SOFT_TEMP_LIMIT    0x00008
+#define VPU_THROTTLED_OCCURRED_MASK      0xF0000  // the same bits shifted by 16
+
+struct TVpuTelemetry
+{
+	unsigned     arm_clock;    // all the clocks are in Hz, 0 = not available
+	unsigned     core_clock;
+	unsigned     uart_clock;
+	int          temperature;  // SoC temperature in 0.001 Celsius
+	unsigned     throttled;    // VPU_THROTTLED_... flags
+	clockcnt_t   updated;      // CLOCKCNT of the last refresh
+	bool         valid;
+};
+
+extern unsigned  g_vpu_telemetry_interval_us;  // refresh interval of broadcom_vpu_telemetry()
+
+unsigned         broadcom_vpu_get_clock_rate(unsigned aclockid);  // actual rate in Hz, 0 = error
+bool             broadcom_vpu_refresh_telemetry();  // all the values with one mailbox call
+TVpuTelemetry *  broadcom_vpu_telemetry();  // cached, refreshed when older than the interval
 
 #endif /* BROADCOM_UTILS_H_ */
@@ -32,6 +32,8 @@
 #include "platform.h"
 #include "hw_utils.h"
 
+#include <time.h>
+
 // free running system timer access initialization for BCM2711
 
 struct THwSystemTimer
@@ -46,12 +48,14 @@ struct THwSystemTimer
 };
 
 static THwSystemTimer *   hw_system_timer = nullptr;
+static bool               hw_system_timer_fallback = false;  // no /dev/mem access
 
 void clockcnt_init()
 {
-	if (!hw_system_timer)
+	if (!hw_system_timer && !hw_system_timer_fallback)
 	{
     hw_system_timer = (THwSystemTimer *)hw_memmap(SYSTEM_TIMER_BASE, sizeof(THwSystemTimer));
+    hw_system_timer_fallback = (hw_system_timer == nullptr);
 	}
 }
 
@@ -60,6 +64,13 @@ uint64_t clockcnt()
 	if (!hw_system_timer)
 	{
 		clockcnt_init();
+		if (hw_system_timer_fallback)
+		{
+			// the monotonic clock in the same 1 MHz units
+			struct timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return (uint64_t(ts.tv_sec) * 1000000 + (ts.tv_nsec / 1000));
+		}
 	}
 
 	uint32_t low;
@@ -0,0 +1,242 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVHAL project: https://github.com/nvitya/nvhal
+ * Copyright (c) 2020 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwbench_broadcom.cpp
+ *  brief:    BROADCOM specific benchmarks
+ *  version:  1.00
+ *  date:     2026-10-19
+ *  authors:  nvitya
+ *  notes:
+ *    The GPIO and UART drivers are pointed to RAM register sets in the simulated
+ *    mode. The DMA is measured only on the real hardware.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hwbench.h"
+#include "hw_utils.h"
+#include "hw_broker.h"
+#include "hwpins.h"
+#include "hwuart.h"
+#include "hwdma.h"
+
+static THwGpioRegs  g_hwbench_sim_gpio;
+static THwUartRegs  g_hwbench_sim_uart;
+
+static const uint8_t  hwbench_dma_bursts[] = {0, 4, 8, 15};
+static const uint8_t  hwbench_dma_widths[] = {4, 16};
+
+bool THwBench::RunPlatform()
+{
+	double t0, t1;
+	char   name[40];
+
+	if (!simulated)
+	{
+		void * p = hw_memmap(HW_GPIO_BASE, sizeof(THwGpioRegs));
+		if (!p)
+		{
+			return false;
+		}
+		hw_memunmap(p);
+	}
+
+	// GPIO
+
+	THwGpioRegs * savedregs = hwpinctrl.regs;
+	int pin = gpio_pin;
+	if (simulated)
+	{
+		memset(&g_hwbench_sim_gpio, 0, sizeof(g_hwbench_sim_gpio));
+		hwpinctrl.regs = &g_hwbench_sim_gpio;
+		hwres_bypass(true);  // do not claim the real pin in the shared resource table
+		pin = 21;
+	}
+
+	if (pin >= 0)
+	{
+		t0 = NowNs();
+		for (unsigned n = 0; n < iterations / 100; ++n)
+		{
+			hwpinctrl.PinSetup(0, pin, PINCFG_OUTPUT | PINCFG_GPIO_INIT_0);
+		}
+		t1 = NowNs();
+		Add("gpio_pinsetup", (t1 - t0) / (iterations / 100), "ns", iterations / 100);
+
+		TGpioPin gpio(0, pin, false);
+
+		t0 = NowNs();
+		for (unsigned n = 0; n < iterations; ++n)
+		{
+			gpio.Set1();
+			gpio.Set0();
+		}
+		t1 = NowNs();
+		Add("gpio_set", (t1 - t0) / (2 * iterations), "ns", 2 * iterations);
+
+		t0 = NowNs();
+		for (unsigned n = 0; n < iterations; ++n)
+		{
+			gpio.Toggle();
+		}
+		t1 = NowNs();
+		Add("gpio_toggle", (t1 - t0) / iterations, "ns", iterations);
+
+		volatile unsigned sink = 0;
+		t0 = NowNs();
+		for (unsigned n = 0; n < iterations; ++n)
+		{
+			sink = gpio.Value();
+		}
+		t1 = NowNs();
+		Add("gpio_value", (t1 - t0) / iterations, "ns", iterations);
+		(void)sink;
+	}
+
+	hwpinctrl.regs = savedregs;
+	hwres_bypass(false);
+
+	// UART
+
+	THwUart uart;
+	bool uartok = false;
+	if (simulated)
+	{
+		memset(&g_hwbench_sim_uart, 0, sizeof(g_hwbench_sim_uart));  // FR = 0: never full
+		uart.regs = &g_hwbench_sim_uart;
+		uartok = true;
+	}
+	else if (uart_devnum >= 0)
+	{
+		uartok = uart.Init(uart_devnum);
+	}
+
+	if (uartok)
+	{
+		const unsigned charcnt = (simulated ? iterations : 1000);
+		t0 = NowNs();
+		for (unsigned n = 0; n < charcnt; ++n)
+		{
+			uart.SendChar('U');
+		}
+		t1 = NowNs();
+		Add("uart_sendchar", (double(charcnt) * 1e9) / (t1 - t0), "char/s", charcnt);
+
+		const unsigned printcnt = (simulated ? iterations / 100 : 10);
+		t0 = NowNs();
+		for (unsigned n = 0; n < printcnt; ++n)
+		{
+			uart.printf("bench %u\r\n", n);
+		}
+		t1 = NowNs();
+		Add("uart_printf", (t1 - t0) / printcnt / 1000.0, "us", printcnt);
+	}
+
+	if (simulated)
+	{
+		return true;
+	}
+
+	// DMA memory to memory
+
+	THwDmaChannel dma;
+	uint8_t * srcbuf = hwdma_allocate_dma_buffer(4096);
+	uint8_t * dstbuf = hwdma_allocate_dma_buffer(4096);
+	if (!srcbuf || !dstbuf || !dma.Alloc(DMA_CHMASK_NORMAL, 0))
+	{
+		return true;
+	}
+
+	THwDmaTransfer xfer;
+	xfer.srcaddr = srcbuf;
+	xfer.dstaddr = dstbuf;
+	xfer.bytewidth = 1;
+	xfer.count = 4096;
+	xfer.flags = DMATR_MEM_TO_MEM;
+
+	const unsigned prepcnt = 1000;
+	t0 = NowNs();
+	for (unsigned n = 0; n < prepcnt; ++n)
+	{
+		dma.PrepareTransfer(&xfer);
+	}
+	t1 = NowNs();
+	Add("dma_prepare", (t1 - t0) / prepcnt, "ns", prepcnt);
+
+	// prepare + start until the channel is enabled, the copy itself is not counted
+
+	const unsigned startcnt = 200;
+	unsigned startok = 0;
+	double starttime = 0;
+	for (unsigned n = 0; n < startcnt; ++n)
+	{
+		t0 = NowNs();
+		bool started = (dma.PrepareTransfer(&xfer) && dma.StartPreparedTransfer());
+		t1 = NowNs();
+		if (!started || !dma.Wait(100000))
+		{
+			dma.Disable();
+			break;
+		}
+		starttime += (t1 - t0);
+		++startok;
+	}
+	if (startok)
+	{
+		Add("dma_prepare_start", starttime / startok, "ns", startok);
+	}
+
+	const unsigned xfercnt = 200;
+	for (unsigned b = 0; b < sizeof(hwbench_dma_bursts); ++b)
+	{
+		for (unsigned w = 0; w < sizeof(hwbench_dma_widths); ++w)
+		{
+			xfer.burstlength = hwbench_dma_bursts[b];
+			xfer.buswidth = hwbench_dma_widths[w];
+
+			bool failed = false;
+			t0 = NowNs();
+			for (unsigned n = 0; n < xfercnt; ++n)
+			{
+				if (!dma.StartTransfer(&xfer) || !dma.Wait(100000))
+				{
+					failed = true;
+					break;
+				}
+			}
+			t1 = NowNs();
+
+			snprintf(name, sizeof(name), "dma_copy_b%u_w%u", hwbench_dma_bursts[b], hwbench_dma_widths[w]);
+			if (failed)
+			{
+				dma.Disable();
+				printf("hwbench: %s failed or timed out, skipped\n", name);
+				continue;
+			}
+			Add(name, (double(xfer.count) * xfercnt * 1000.0) / (t1 - t0), "MB/s", xfercnt);
+		}
+	}
+
+	dma.Release();
+
+	return true;
+}
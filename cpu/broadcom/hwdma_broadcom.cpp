@@ -25,21 +25,43 @@
  *  date:     2020-10-03
  *  authors:  nvitya
  *  notes:
- *    Only channels 0-6 are supported here, excluding the Lite and DMA4 channels.
+ *    Channels 0-6 are normal, 7-10 are Lite and 11-14 are DMA4 channels, the DMA4
+ *    has its own control block format which is handled in PrepareTransferDma4().
  *    Allocates an uncached memory and uses that for DMA buffers and control blocks.
- *    The uncached memory is allocated using the Video Core.
+ *    The uncached memory is allocated using the Video Core, it is reused after restarts
+ *    through the HWDMA_ARENA_STATE_FILE.
+ *    Optionally cached DMA buffers can be allocated from locked user pages or 2 MB
+ *    hugepages (these must be reserved with vm.nr_hugepages), the cached buffers
+ *    are cleaned / invalidated around the transfers (AArch64 only). The kernel
+ *    might still migrate the locked pages unless vm.compact_unevictable_allowed = 0.
 */
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <errno.h>
 
 #include "hwdma.h"
 #include "hw_utils.h"
+#include "hw_broker.h"
+#include "hwtrace.h"
 #include "broadcom_utils.h"
 #include "clockcnt.h"
 
 uint8_t *  g_dma_channel_regs = nullptr;
 
+// channel ownership in this process
+static void *    g_dma_channel_owner[MAX_DMA_CHANNELS] = {0};
+static bool      g_dma_atexit_registered = false;
+static unsigned  g_dma_firmware_mask = 0;
+
 // uncached memory for DMA buffers and control blocks
 // this must be allocated using the VPU
 
@@ -51,6 +73,44 @@ unsigned   g_dmabuf_mem_handle = 0;
 unsigned   g_dmabuf_bus_addr = 0;
 unsigned   g_dmabuf_phys_addr = 0;
 
+// The VPU memory is not freed when the process exits, so the arena is recorded in a
+// state file and reattached on the next start. The handle is validated by locking
+// it again, which returns the same bus address for a still allocated block.
+
+#define HWDMA_ARENA_MAGIC  0x414D4448  // "HDMA"
+
+struct THwDmaArenaState
+{
+	uint32_t    magic;
+	uint32_t    handle;
+	uint32_t    bus_addr;
+	uint32_t    size;
+	int32_t     pid;    // last user process
+};
+
+static bool hwdma_pid_alive(int apid)
+{
+	return (apid > 0) && ((kill(apid, 0) == 0) || (errno == EPERM));
+}
+
+static bool hwdma_read_arena_state(int afd, THwDmaArenaState * rstate)
+{
+	if (pread(afd, rstate, sizeof(*rstate), 0) != sizeof(*rstate))
+	{
+		return false;
+	}
+	return (rstate->magic == HWDMA_ARENA_MAGIC);
+}
+
+static void hwdma_write_arena_state(int afd, THwDmaArenaState * astate)
+{
+	if (ftruncate(afd, 0) == 0)
+	{
+		ssize_t r = pwrite(afd, astate, sizeof(*astate), 0);
+		(void)r;
+	}
+}
+
 bool hwdma_init_dma_buffer()
 {
 	if (g_dma_buffer)
@@ -58,24 +118,141 @@ bool hwdma_init_dma_buffer()
 		return true;
 	}
 
-	// the allocated memory won't be freed when this application exits
+	g_dma_buffer_size = HWDMA_BUFFER_SIZE;
 
-	//TODO: reuse the existing allocation
+	THwDmaArenaState  state;
+	bool              reused = false;
+	int statefd = open(HWDMA_ARENA_STATE_FILE, O_RDWR | O_CREAT, 0600);
+	if (statefd >= 0)
+	{
+		flock(statefd, LOCK_EX);
 
-	g_dma_buffer_size = HWDMA_BUFFER_SIZE;
+		// the recorded arena is owned through the resource broker, the PID in the
+		// state file covers the case when the shared memory is not available
+		bool inuse = !hwres_claim(HWRES_ARENA, HWRES_ARENA_DMA);
+		if (!inuse && hwdma_read_arena_state(statefd, &state))
+		{
+			if ((state.pid != getpid()) && hwdma_pid_alive(state.pid))
+			{
+				hwres_release(HWRES_ARENA, HWRES_ARENA_DMA);
+				inuse = true;
+			}
+			else if (state.size == g_dma_buffer_size)
+			{
+				// the arena was left locked, unlock first so that the lock count does not grow
+				broadcom_vpu_mem_unlock(state.handle);
+				unsigned bus_addr = broadcom_vpu_mem_lock(state.handle);
+				if (bus_addr == state.bus_addr)
+				{
+					g_dmabuf_mem_handle = state.handle;
+					g_dmabuf_bus_addr = state.bus_addr;
+					reused = true;
+				}
+				else if (bus_addr)  // moved, the control blocks and buffers are lost anyway
+				{
+					broadcom_vpu_mem_unlock_free(state.handle);
+				}
+			}
+			else  // stale arena with an other size
+			{
+				broadcom_vpu_mem_unlock_free(state.handle);
+			}
+		}
+
+		if (inuse)
+		{
+			// used by a running process, this one gets an own unrecorded arena
+			flock(statefd, LOCK_UN);
+			close(statefd);
+			statefd = -1;
+		}
+	}
 
-	printf("Allocating %u byte uncached DMA buffer\n", g_dma_buffer_size);
+	if (!reused)
+	{
+		printf("Allocating %u byte uncached DMA buffer\n", g_dma_buffer_size);
+
+		g_dmabuf_mem_handle = broadcom_vpu_mem_alloc(g_dma_buffer_size);
+		//printf(" mem_handle = %08X\n", mem_handle);
+		g_dmabuf_bus_addr = broadcom_vpu_mem_lock(g_dmabuf_mem_handle);
+		//printf(" bus_addr   = %08X\n", bus_addr);
+	}
 
-	g_dmabuf_mem_handle = broadcom_vpu_mem_alloc(g_dma_buffer_size);
-	//printf(" mem_handle = %08X\n", mem_handle);
-	g_dmabuf_bus_addr = broadcom_vpu_mem_lock(g_dmabuf_mem_handle);
-	//printf(" bus_addr   = %08X\n", bus_addr);
 	g_dmabuf_phys_addr = (g_dmabuf_bus_addr & 0x3FFFFFFF);
 	// printf(" phys_addr  = %08X\n", phys_addr);
 
+	if (statefd >= 0)
+	{
+		if (g_dmabuf_mem_handle && g_dmabuf_bus_addr)
+		{
+			state.magic = HWDMA_ARENA_MAGIC;
+			state.handle = g_dmabuf_mem_handle;
+			state.bus_addr = g_dmabuf_bus_addr;
+			state.size = g_dma_buffer_size;
+			state.pid = getpid();
+			hwdma_write_arena_state(statefd, &state);
+		}
+		flock(statefd, LOCK_UN);
+		close(statefd);
+	}
+
+	if (!g_dmabuf_bus_addr)
+	{
+		return false;
+	}
+
 	g_dma_buffer = (uint8_t *)hw_memmap(g_dmabuf_phys_addr, g_dma_buffer_size);
 
-	return true;
+	return (g_dma_buffer != nullptr);
+}
+
+bool hwdma_cleanup_dma_arena()
+{
+	int statefd = open(HWDMA_ARENA_STATE_FILE, O_RDWR);
+	if (statefd < 0)
+	{
+		return true;  // nothing recorded
+	}
+
+	bool result = true;
+	THwDmaArenaState  state;
+	flock(statefd, LOCK_EX);
+	if (hwdma_read_arena_state(statefd, &state))
+	{
+		int owner = hwres_owner(HWRES_ARENA, HWRES_ARENA_DMA);
+		if ((0 == owner) && hwdma_pid_alive(state.pid))
+		{
+			owner = state.pid;  // no shared memory
+		}
+
+		if (owner && (owner != getpid()))
+		{
+			printf("DMA: the arena is still used by process %i\n", owner);
+			result = false;
+		}
+		else
+		{
+			if (g_dma_buffer && (state.handle == g_dmabuf_mem_handle))
+			{
+				// the control blocks of the claimed channels are in the arena, stop them first
+				hwdma_release_all_channels();
+				hw_memunmap(g_dma_buffer);
+				g_dma_buffer = nullptr;
+				g_dma_buffer_allocated = 0;
+			}
+			broadcom_vpu_mem_unlock_free(state.handle);
+		}
+	}
+
+	if (result)
+	{
+		unlink(HWDMA_ARENA_STATE_FILE);
+		hwres_release(HWRES_ARENA, HWRES_ARENA_DMA);
+	}
+
+	flock(statefd, LOCK_UN);
+	close(statefd);
+	return result;
 }
 
 uint8_t * hwdma_allocate_dma_buffer(unsigned asize)  // no freeing yet
@@ -98,8 +275,227 @@ uint8_t * hwdma_allocate_dma_buffer(unsigned asize)  // no freeing yet
 	return result;
 }
 
+// cached memory regions for the DMA buffers: locked user pages (only the single
+// pages are known to be physically contiguous) and optionally 2 MB hugepages
+
+struct THwDmaRegion
+{
+	uint8_t *    base;
+	unsigned     size;
+	unsigned     allocated;
+	unsigned     pagesize;
+	uint64_t *   pagephys;  // physical address of each page
+};
+
+#define HWDMA_REGION_CACHED  0
+#define HWDMA_REGION_HUGE    1
+#define HWDMA_MAX_REGIONS    2
+
+static THwDmaRegion  g_dma_region[HWDMA_MAX_REGIONS] = {};
+
+static bool hwdma_map_region(THwDmaRegion * argn, unsigned asize, unsigned apagesize, int amapflags)
+{
+#if defined(__aarch64__)
+	if (argn->base)
+	{
+		return true;
+	}
+
+	asize = ((asize + apagesize - 1) & ~(apagesize - 1));
+
+	uint8_t * p = (uint8_t *)mmap(nullptr, asize, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_LOCKED | MAP_POPULATE | amapflags, -1, 0);
+	if (p == MAP_FAILED)
+	{
+		return false;
+	}
+
+	unsigned pagecount = asize / apagesize;
+	uint64_t * pagephys = (uint64_t *)malloc(pagecount * sizeof(uint64_t));
+	if (!pagephys || !hw_virt_to_phys_pages(p, pagecount, apagesize, pagephys))
+	{
+		printf("DMA: physical address of the cached buffer is not available\n");
+		free(pagephys);
+		munmap(p, asize);
+		return false;
+	}
+
+	argn->pagephys = pagephys;
+	argn->pagesize = apagesize;
+	argn->size = asize;
+	argn->allocated = 0;
+	argn->base = p;
+	return true;
+#else
+	(void)argn;
+	(void)asize;
+	(void)apagesize;
+	(void)amapflags;
+	return false;  // the cache maintenance instructions are not available here
+#endif
+}
+
+bool hwdma_phys_usable(uint64_t aphys, unsigned alen, int achtype)
+{
+	uint64_t limit = (DMA_CHTYPE_DMA4 == achtype ? HWDMA_DMA4_PHYS_LIMIT : HWDMA_LEGACY_PHYS_LIMIT);
+	return (aphys + alen <= limit);
+}
+
+static uint8_t * hwdma_region_alloc(THwDmaRegion * argn, unsigned asize, int achtype)
+{
+	asize = ((asize + 31) & 0xFFFFFFE0);  // 32 byte granularity
+
+	unsigned offs = argn->allocated;
+	while (asize <= argn->size - offs)
+	{
+		// the whole range must be physically contiguous
+		unsigned firstpage = offs / argn->pagesize;
+		unsigned lastpage = (offs + asize - 1) / argn->pagesize;
+		unsigned pg = firstpage;
+		while ((pg < lastpage) && (argn->pagephys[pg] + argn->pagesize == argn->pagephys[pg + 1]))
+		{
+			++pg;
+		}
+
+		if (pg < lastpage)
+		{
+			offs = (pg + 1) * argn->pagesize;  // restart after the discontinuity
+			continue;
+		}
+
+		uint64_t phys = argn->pagephys[firstpage] + (offs & (argn->pagesize - 1));
+		if (hwdma_phys_usable(phys, asize, achtype))
+		{
+			argn->allocated = offs + asize;
+			return argn->base + offs;
+		}
+
+		offs = (firstpage + 1) * argn->pagesize;  // out of the reach of the channel type
+	}
+
+	return nullptr;
+}
+
+static THwDmaRegion * hwdma_find_region(void * aaddr)
+{
+	for (unsigned n = 0; n < HWDMA_MAX_REGIONS; ++n)
+	{
+		THwDmaRegion * rgn = &g_dma_region[n];
+		if (rgn->base && (aaddr >= rgn->base) && (aaddr < rgn->base + rgn->size))
+		{
+			return rgn;
+		}
+	}
+	return nullptr;
+}
+
+uint8_t * hwdma_allocate_cached_buffer(unsigned asize)
+{
+	THwDmaRegion * rgn = &g_dma_region[HWDMA_REGION_CACHED];
+	uint8_t * result = nullptr;
+	if (hwdma_map_region(rgn, HWDMA_CACHED_BUFFER_SIZE, HWDMA_CACHED_PAGE_SIZE, 0))
+	{
+		result = hwdma_region_alloc(rgn, asize, DMA_CHTYPE_NORMAL);  // usable by every channel
+	}
+
+	if (!result)
+	{
+		result = hwdma_allocate_dma_buffer(asize);
+	}
+	return result;
+}
+
+bool hwdma_init_huge_buffer(unsigned asize)
+{
+	return hwdma_map_region(&g_dma_region[HWDMA_REGION_HUGE], asize, HWDMA_HUGE_PAGE_SIZE, MAP_HUGETLB);
+}
+
+uint8_t * hwdma_allocate_huge_buffer(unsigned asize, int achtype)
+{
+	if (!hwdma_init_huge_buffer(HWDMA_HUGE_BUFFER_SIZE))
+	{
+		return nullptr;
+	}
+
+	// the kernel often places the hugepages high in the RAM, out of the reach of the normal channels
+	uint8_t * result = hwdma_region_alloc(&g_dma_region[HWDMA_REGION_HUGE], asize, achtype);
+	if (!result && (DMA_CHTYPE_DMA4 != achtype))
+	{
+		printf("DMA: no hugepage memory below 1 GB, only a DMA4 channel could use it\n");
+	}
+	return result;
+}
+
+bool hwdma_is_cached(void * aaddr)
+{
+	return (hwdma_find_region(aaddr) != nullptr);
+}
+
+static uint64_t hwdma_cached_phys_address(void * aaddr)
+{
+	THwDmaRegion * rgn = hwdma_find_region(aaddr);
+	unsigned offs = (uint8_t *)aaddr - rgn->base;
+	return rgn->pagephys[offs / rgn->pagesize] + (offs & (rgn->pagesize - 1));
+}
+
+#if defined(__aarch64__)
+
+static unsigned hwdma_dcache_line_size()
+{
+	uint64_t ctr;
+	asm volatile ("mrs %0, ctr_el0" : "=r" (ctr));
+	return (4 << ((ctr >> 16) & 0xF));  // DminLine: log2 of words
+}
+
+// DC IVAC is not allowed at EL0, so the invalidation is done with DC CIVAC,
+// this is fine as long as the CPU does not write the buffer during the transfer
+
+#define HWDMA_DC_RANGE(op, aaddr, alen) \
+	{ \
+		uintptr_t line = hwdma_dcache_line_size(); \
+		uintptr_t end = uintptr_t(aaddr) + alen; \
+		for (uintptr_t a = (uintptr_t(aaddr) & ~(line - 1)); a < end; a += line) \
+		{ \
+			asm volatile ("dc " op ", %0" : : "r" (a) : "memory"); \
+		} \
+		asm volatile ("dsb sy" : : : "memory"); \
+	}
+
+void hwdma_cache_clean(void * aaddr, unsigned alen)
+{
+	HWDMA_DC_RANGE("cvac", aaddr, alen);
+}
+
+void hwdma_cache_invalidate(void * aaddr, unsigned alen)
+{
+	HWDMA_DC_RANGE("civac", aaddr, alen);
+}
+
+#else
+
+void hwdma_cache_clean(void *, unsigned)
+{
+}
+
+void hwdma_cache_invalidate(void *, unsigned)
+{
+}
+
+#endif
+
 unsigned hwdma_bus_address(void * aaddr)
 {
+	if (hwdma_is_cached(aaddr))
+	{
+		uint64_t phys = hwdma_cached_phys_address(aaddr);
+		if (phys >= 0x40000000)
+		{
+			printf("DMA: cached buffer above 1 GB, use a DMA4 channel\n");
+			return 0;
+		}
+		return (0xC0000000 | unsigned(phys));  // uncached (L2 bypass) alias
+	}
+
 	if ((aaddr < g_dma_buffer) || (aaddr > g_dma_buffer + g_dma_buffer_size))
 	{
 		printf("invalid address for DMA tranfer: %p\n", aaddr);
@@ -110,12 +506,266 @@ unsigned hwdma_bus_address(void * aaddr)
 	return g_dmabuf_bus_addr + offs;
 }
 
+uint64_t hwdma_phys_address(void * aaddr)
+{
+	if (hwdma_is_cached(aaddr))
+	{
+		return hwdma_cached_phys_address(aaddr);
+	}
+
+	if ((aaddr < g_dma_buffer) || (aaddr > g_dma_buffer + g_dma_buffer_size))
+	{
+		printf("invalid address for DMA tranfer: %p\n", aaddr);
+		return 0;
+	}
+
+	unsigned offs = (uint8_t *)aaddr - g_dma_buffer;
+	return uint64_t(g_dmabuf_phys_addr) + offs;
+}
+
+int hwdma_channel_type(int achnum)
+{
+	if (achnum >= 11)  return DMA_CHTYPE_DMA4;
+	if (achnum >= 7)   return DMA_CHTYPE_LITE;
+	return DMA_CHTYPE_NORMAL;
+}
+
+static unsigned hwdma_read_dt_mask(const char * anodename)
+{
+	char  fname[128];
+	snprintf(fname, sizeof(fname), "/proc/device-tree/soc/%s/brcm,dma-channel-mask", anodename);
+
+	FILE * f = fopen(fname, "rb");
+	if (!f)
+	{
+		return 0;
+	}
+
+	uint8_t  b[4];
+	unsigned result = 0;
+	if (fread(&b[0], 1, 4, f) == 4)
+	{
+		result = ((b[0] << 24) | (b[1] << 16) | (b[2] << 8) | b[3]);  // big endian
+	}
+	fclose(f);
+	return result;
+}
+
+static unsigned hwdma_firmware_mask()
+{
+	if (!g_dma_firmware_mask)
+	{
+		g_dma_firmware_mask = (broadcom_vpu_get_dma_channels() & DMA_CHMASK_ALL);
+		if (!g_dma_firmware_mask)
+		{
+			g_dma_firmware_mask = ((hwdma_read_dt_mask("dma@7e007000") | hwdma_read_dt_mask("dma@7e007b00")) & DMA_CHMASK_ALL);
+		}
+		if (!g_dma_firmware_mask)
+		{
+			g_dma_firmware_mask = DMA_CHMASK_ALL;
+		}
+	}
+	return g_dma_firmware_mask;
+}
+
+// returns the n-th set bit of the mask, -1 if not found
+static int hwdma_mask_bit_index(unsigned amask, unsigned an)
+{
+	for (int i = 0; i < MAX_DMA_CHANNELS; ++i)
+	{
+		if (amask & (1u << i))
+		{
+			if (0 == an)  return i;
+			--an;
+		}
+	}
+	return -1;
+}
+
+// The kernel dmaengine numbers the channels of a controller in the order
+// of the set bits of its channel mask: dma<X>chan<N> = N-th available channel.
+static unsigned hwdma_kernel_channels()
+{
+	unsigned result = 0;
+
+	DIR * dir = opendir("/sys/class/dma");
+	if (!dir)
+	{
+		return 0;
+	}
+
+	unsigned fwmask = hwdma_firmware_mask();
+	struct dirent * de;
+	while ((de = readdir(dir)) != nullptr)
+	{
+		int ctrl, n;
+		if (sscanf(de->d_name, "dma%dchan%d", &ctrl, &n) != 2)
+		{
+			continue;
+		}
+
+		char  fname[300];
+		char  buf[64];
+		snprintf(fname, sizeof(fname), "/sys/class/dma/%s/in_use", de->d_name);
+		FILE * f = fopen(fname, "r");
+		if (!f)
+		{
+			continue;
+		}
+		int inuse = 0;
+		if (fscanf(f, "%d", &inuse) != 1)  inuse = 0;
+		fclose(f);
+		if (!inuse)
+		{
+			continue;
+		}
+
+		snprintf(fname, sizeof(fname), "/sys/class/dma/%s/device", de->d_name);
+		int r = readlink(fname, buf, sizeof(buf) - 1);
+		buf[(r > 0 ? r : 0)] = 0;
+
+		int chnum;
+		if (strstr(buf, "7b00.dma"))  // the DMA4 controller
+		{
+			chnum = hwdma_mask_bit_index(fwmask & DMA_CHMASK_DMA4, n);
+		}
+		else
+		{
+			chnum = hwdma_mask_bit_index(fwmask & ~DMA_CHMASK_DMA4, n);
+		}
+
+		if (chnum >= 0)
+		{
+			result |= (1u << chnum);
+		}
+	}
+
+	closedir(dir);
+	return result;
+}
+
+unsigned hwdma_usable_channels()
+{
+	return (hwdma_firmware_mask() & ~hwdma_kernel_channels());
+}
+
+bool hwdma_claim_channel(int achnum, void * aowner)
+{
+	if ((achnum < 0) || (achnum >= MAX_DMA_CHANNELS))
+	{
+		return false;
+	}
+
+	void * expected = nullptr;
+	if (!__atomic_compare_exchange_n(&g_dma_channel_owner[achnum], &expected, aowner, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	{
+		if (expected != aowner)
+		{
+			return false;  // used by an other object
+		}
+	}
+	else if (!hwres_claim(HWRES_DMA_CHANNEL, achnum))  // used by an other process
+	{
+		g_dma_channel_owner[achnum] = nullptr;
+		return false;
+	}
+
+	if (!__atomic_exchange_n(&g_dma_atexit_registered, true, __ATOMIC_ACQ_REL))  // only once from any thread
+	{
+		atexit(hwdma_release_all_channels);
+	}
+
+	return true;
+}
+
+void hwdma_release_channel(int achnum, void * aowner)
+{
+	if ((achnum < 0) || (achnum >= MAX_DMA_CHANNELS))
+	{
+		return;
+	}
+
+	void * expected = aowner;
+	if (__atomic_compare_exchange_n(&g_dma_channel_owner[achnum], &expected, nullptr, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	{
+		hwres_release(HWRES_DMA_CHANNEL, achnum);
+	}
+}
+
+int hwdma_alloc_channel(unsigned achmask, void * aowner)
+{
+	unsigned freemask = (hwdma_usable_channels() & achmask);
+
+	// the kernel allocates from the lowest channel numbers, so start from the top
+	for (int i = MAX_DMA_CHANNELS - 1; i >= 0; --i)
+	{
+		if ((freemask & (1u << i)) && hwdma_claim_channel(i, aowner))
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+void hwdma_release_all_channels()
+{
+	// stop the channels, the DMA buffer (VPU memory) survives the process
+	for (int i = 0; i < MAX_DMA_CHANNELS; ++i)
+	{
+		if (g_dma_channel_owner[i])
+		{
+			if (g_dma_channel_regs)
+			{
+				TDmaChannelRegs * chregs = (TDmaChannelRegs *)(g_dma_channel_regs + i * 0x100);
+				if (DMA_CHTYPE_DMA4 == hwdma_channel_type(i))
+				{
+					((TDma4ChannelRegs *)chregs)->DEBUG = DMA4_DEBUG_RESET;
+				}
+				else
+				{
+					chregs->CS = DMA_CS_RESET;
+				}
+			}
+			g_dma_channel_owner[i] = nullptr;
+			hwres_release(HWRES_DMA_CHANNEL, i);
+		}
+	}
+}
+
+bool THwDmaChannel_broadcom::Alloc(unsigned achmask, int admarq)
+{
+	int ch = hwdma_alloc_channel(achmask, this);
+	if (ch < 0)
+	{
+		printf("DMA: no free channel\n");
+		return false;
+	}
+
+	return Init(ch, admarq);
+}
+
+void THwDmaChannel_broadcom::Release()
+{
+	if (initialized)
+	{
+		Disable();
+	}
+	hwdma_release_channel(chnum, this);
+	initialized = false;
+}
+
 bool THwDmaChannel_broadcom::Init(int achnum, int admarq)  // admarq = peripheral DMA Request ID
 {
 	initialized = false;
 
   // channel init
 
+	if ((chnum >= 0) && (chnum != achnum))
+	{
+		hwdma_release_channel(chnum, this);
+	}
+
 	chnum = achnum;
 	dmarq = admarq;
 
@@ -125,17 +775,39 @@ bool THwDmaChannel_broadcom::Init(int achnum, int admarq)  // admarq = periphera
 		return false;
 	}
 
+	if (!hwdma_claim_channel(chnum, this))
+	{
+		printf("DMA%i: the channel is already in use\n", chnum);
+		chnum = -1;
+		return false;
+	}
+
+	if (0 == (hwdma_firmware_mask() & (1u << chnum)))
+	{
+		printf("DMA%i: warning, the channel is reserved by the firmware\n", chnum);
+	}
+
 	if (!hwdma_init_dma_buffer())
 	{
+		hwdma_release_channel(chnum, this);  // do not keep the claim of a failed init
+		chnum = -1;
 		return false;
 	}
 
 	if (!g_dma_channel_regs)
 	{
 		g_dma_channel_regs = (uint8_t *)hw_memmap(HWDMA_BASE_ADDRESS, 4096);
+		if (!g_dma_channel_regs)
+		{
+			hwdma_release_channel(chnum, this);
+			chnum = -1;
+			return false;
+		}
 	}
 
   regs = (TDmaChannelRegs *)(g_dma_channel_regs + achnum * 0x100);
+  chtype = hwdma_channel_type(chnum);
+  regs4 = (DMA_CHTYPE_DMA4 == chtype ? (TDma4ChannelRegs *)regs : nullptr);
 
   // allocate the control blocks in the uncached memory
   if (!cb)
@@ -143,11 +815,20 @@ bool THwDmaChannel_broadcom::Init(int achnum, int admarq)  // admarq = periphera
   	cb = (TDmaControlBlock *)hwdma_allocate_dma_buffer(sizeof(TDmaControlBlock));
   	if (!cb)
   	{
+  		hwdma_release_channel(chnum, this);
+  		chnum = -1;
   		return false;
   	}
   }
 
-  regs->CS = (1u << 31); // reset
+  if (regs4)
+  {
+  	regs4->DEBUG = DMA4_DEBUG_RESET;  // the CS bit 31 is HALT here
+  }
+  else
+  {
+  	regs->CS = (1u << 31); // reset
+  }
   delay_us(1);
 
   cs_reg_base = 0
@@ -157,9 +838,9 @@ bool THwDmaChannel_broadcom::Init(int achnum, int admarq)  // admarq = periphera
     | ((priority & 15) << 20)  // PRIORITY(4)
   ;
 
-  regs->CONBLK_AD = 0;
+  regs->CONBLK_AD = 0;  // CB for the DMA4
 
-  regs->CS = cs_reg_base;
+  regs->CS = cs_reg_base;  // the DMA4 has the same bits here (QOS instead of PRIORITY)
 
 	initialized = true;
 
@@ -172,18 +853,162 @@ void THwDmaChannel_broadcom::Prepare(bool aistx, unsigned aperiphaddr)
 	periphaddr = aperiphaddr;
 }
 
-void THwDmaChannel_broadcom::PrepareTransfer(THwDmaTransfer * axfer)
+bool THwDmaChannel_broadcom::PrepareTransfer(THwDmaTransfer * axfer)
 {
-	if (axfer->count == 0)  // avoid special errors
+	xfer_prepared = false;  // the CB is not valid until the end
+
+	if ((axfer->count == 0) && ((axfer->flags & DMATR_2D) == 0))  // avoid special errors
 	{
-		return;
+		return false;
+	}
+
+	HWTRACE(HWTR_DMA_PREPARE, chnum, axfer->flags);
+
+	MaintainCaches(axfer);
+
+	addr_error = false;
+
+	bool ok;
+	if (axfer->flags & DMATR_2D)
+	{
+		ok = Prepare2DTransfer(axfer);
+	}
+	else if (DMA_CHTYPE_DMA4 == chtype)
+	{
+		ok = PrepareTransferDma4(axfer);
+	}
+	else if (axfer->flags & DMATR_MEM_TO_MEM)
+	{
+		ok = PrepareMemTransfer(axfer);
+	}
+	else if (DMA_CHTYPE_LITE == chtype)
+	{
+		ok = PrepareTransferLite(axfer);
+	}
+	else
+	{
+		ok = PreparePeriphTransfer(axfer);
+	}
+
+	if (!ok || addr_error)  // an address of 0 would be used by the DMA
+	{
+		return false;
+	}
+
+	if ((axfer->flags & DMATR_IRQ) || (irqfd >= 0))
+	{
+		cb->TI |= DMA_CB_TI_INTEN;  // bit 0 in the DMA4 control block too
+	}
+
+	if (axfer->flags & DMATR_2D)
+	{
+		xfer_length = axfer->xlength * axfer->ycount;
+	}
+	else
+	{
+		xfer_length = axfer->count * axfer->bytewidth;
+	}
+	xfer_circular = (0 != (axfer->flags & DMATR_CIRCULAR));
+	xfer_started = false;
+	prog_laps = 0;
+	prog_lastpos = 0;
+	xfer_prepared = true;
+	return true;
+}
+
+unsigned THwDmaChannel_broadcom::BusAddress(void * aaddr)
+{
+	unsigned result = hwdma_bus_address(aaddr);
+	if (!result)
+	{
+		addr_error = true;
+	}
+	return result;
+}
+
+uint64_t THwDmaChannel_broadcom::PhysAddress(void * aaddr)
+{
+	uint64_t result = hwdma_phys_address(aaddr);
+	if (!result)
+	{
+		addr_error = true;
 	}
+	return result;
+}
+
+bool THwDmaChannel_broadcom::StartPreparedTransfer()
+{
+	if (!xfer_prepared)
+	{
+		return false;  // the CB belongs to an earlier transfer
+	}
+
+	xfer_started = true;
+	Enable();
+	return true;
+}
+
+void THwDmaChannel_broadcom::MaintainCaches(THwDmaTransfer * axfer)
+{
+	cached_dst = nullptr;
+	cached_dst_len = 0;
+
+	bool srcmem = (axfer->flags & DMATR_MEM_TO_MEM) || istx;
+	bool dstmem = (axfer->flags & DMATR_MEM_TO_MEM) || !istx;
+
+	uint8_t * srcaddr = (uint8_t *)axfer->srcaddr;
+	uint8_t * dstaddr = (uint8_t *)axfer->dstaddr;
+	unsigned  srclen;
+	unsigned  dstlen;
+
+	if (axfer->flags & DMATR_2D)
+	{
+		// the rows might go backwards with negative strides
+		int srcrow = axfer->xlength + axfer->srcstride;
+		int dstrow = axfer->xlength + axfer->dststride;
+		int ylast = (axfer->ycount ? axfer->ycount - 1 : 0);
+		if (srcrow < 0)  srcaddr += srcrow * ylast;
+		if (dstrow < 0)  dstaddr += dstrow * ylast;
+		srclen = abs(srcrow) * ylast + axfer->xlength;
+		dstlen = abs(dstrow) * ylast + axfer->xlength;
+	}
+	else
+	{
+		srclen = ((axfer->flags & DMATR_NO_SRC_INC) ? axfer->bytewidth : axfer->count * axfer->bytewidth);
+		dstlen = ((axfer->flags & DMATR_NO_DST_INC) ? axfer->bytewidth : axfer->count * axfer->bytewidth);
+	}
+
+	if (srcmem && hwdma_is_cached(srcaddr))
+	{
+		hwdma_cache_clean(srcaddr, srclen);
+	}
+
+	if (dstmem && hwdma_is_cached(dstaddr))
+	{
+		// dirty lines must not be evicted over the DMA data
+		hwdma_cache_invalidate(dstaddr, dstlen);
+		cached_dst = dstaddr;
+		cached_dst_len = dstlen;
+	}
+}
+
+void THwDmaChannel_broadcom::FinishTransfer()
+{
+	if (cached_dst)
+	{
+		// drop the lines that were speculatively loaded during the transfer
+		hwdma_cache_invalidate(cached_dst, cached_dst_len);
+	}
+}
+
+bool THwDmaChannel_broadcom::PreparePeriphTransfer(THwDmaTransfer * axfer)
+{
+	tdmode = true;
+	rowlength = axfer->bytewidth;
 
 	uint32_t tinfo = 0
-		| (1 << 26)  // NO_WIDE_BURSTS: 0 = enable 2 cycle bursts, 1 = no wide bursts
-		| (0 << 21)  // WAITS(5): Add Wait Cycles
+		| BurstTiBits(axfer, false)  // NO_WIDE_BURSTS(26), WAITS(25:21), BURST_LENGTH(15:12)
 		| (dmarq << 16)  // PERMAP(5): Peripheral mapping
-		| (0 << 12)  // BURST_LENGTH(4): 0 = single
 		| (0 << 11)  // SRC_IGNORE: 0 = read from the source address
 		| (0 << 10)  // SRC_DREQ: 1 = reads are controller by the DMA request signal
 		| (0 <<  9)  // SRC_WIDTH: 0 = 32 bit, 1 = 128 bit
@@ -209,7 +1034,7 @@ void THwDmaChannel_broadcom::PrepareTransfer(THwDmaTransfer * axfer)
 
 		tinfo |= (1 << 6);  // DEST_DREQ
 
-		cb->SOURCE_AD = hwdma_bus_address(axfer->srcaddr);
+		cb->SOURCE_AD = BusAddress(axfer->srcaddr);
 		cb->DEST_AD = periphaddr;
 	}
 	else // PER -> MEM
@@ -222,29 +1047,383 @@ void THwDmaChannel_broadcom::PrepareTransfer(THwDmaTransfer * axfer)
 		tinfo |= (1 << 10);  // SRC_DREQ
 
 		cb->SOURCE_AD = periphaddr;
-		cb->DEST_AD = hwdma_bus_address(axfer->dstaddr);
+		cb->DEST_AD = BusAddress(axfer->dstaddr);
 	}
 
 	cb->TI = tinfo;
 	cb->TXFR_LEN = (((axfer->count-1) << 16) | axfer->bytewidth);
 	cb->STRIDE = ((dinc << 16) | sinc);
 
+	SetNextCb(axfer);
+	return true;
+}
+
+void THwDmaChannel_broadcom::SetNextCb(THwDmaTransfer * axfer)
+{
 	if (axfer->flags & DMATR_CIRCULAR)
 	{
-		cb->NEXTCONBK = hwdma_bus_address(cb);  // loop back to self
+		cb->NEXTCONBK = BusAddress(cb);  // loop back to self
 	}
 	else
 	{
 		cb->NEXTCONBK = 0;
 	}
 
-  regs->CONBLK_AD = hwdma_bus_address(cb);  // set the control block address
+  regs->CONBLK_AD = BusAddress(cb);  // set the control block address
+}
+
+bool THwDmaChannel_broadcom::PrepareMemTransfer(THwDmaTransfer * axfer)
+{
+	// both addresses are in memory: no DREQ, simple (1D) length, wide accesses and bursts
+
+	unsigned len = axfer->count * axfer->bytewidth;
+	unsigned srcaddr = BusAddress(axfer->srcaddr);
+	unsigned dstaddr = BusAddress(axfer->dstaddr);
+
+	uint32_t tinfo = DMA_CB_TI_WAIT_RESP;
+
+	if ((axfer->flags & DMATR_NO_SRC_INC) == 0)  tinfo |= DMA_CB_TI_SRC_INC;
+	if ((axfer->flags & DMATR_NO_DST_INC) == 0)  tinfo |= DMA_CB_TI_DEST_INC;
+
+	if ((DMA_CHTYPE_LITE == chtype) && (len > DMA_LITE_MAX_LENGTH))
+	{
+		printf("DMA%i: transfer too long for a Lite channel\n", chnum);
+		return false;  // not truncated, the caller has to split it
+	}
+
+	tinfo |= BurstTiBits(axfer, true);
+
+	if (16 == MemBusWidth(axfer, srcaddr, dstaddr, len))
+	{
+		tinfo |= (DMA_CB_TI_SRC_WIDTH | DMA_CB_TI_DEST_WIDTH);  // 128 bit accesses
+	}
+
+	cb->TI = tinfo;
+	cb->SOURCE_AD = srcaddr;
+	cb->DEST_AD = dstaddr;
+	cb->TXFR_LEN = len;
+	cb->STRIDE = 0;
+
+	tdmode = false;
+
+	SetNextCb(axfer);
+	return true;
+}
+
+bool THwDmaChannel_broadcom::PrepareTransferLite(THwDmaTransfer * axfer)
+{
+	// The Lite channels have no 2D mode, so the items can not be transferred one by one
+	// with the stride. The peripheral side is accessed with 32 bit words,
+	// so only 4 byte items are possible here.
+
+	unsigned len = axfer->count * axfer->bytewidth;
+	if ((axfer->bytewidth != 4) || (len > DMA_LITE_MAX_LENGTH))
+	{
+		printf("DMA%i: unsupported transfer for a Lite channel\n", chnum);
+		return false;
+	}
+
+	uint32_t tinfo = 0
+		| BurstTiBits(axfer, false)
+		| (dmarq << 16)  // PERMAP(5): Peripheral mapping
+		| DMA_CB_TI_WAIT_RESP
+	;
+
+	if (istx)  // MEM -> PER
+	{
+		if ((axfer->flags & DMATR_NO_SRC_INC) == 0)  tinfo |= DMA_CB_TI_SRC_INC;
+		tinfo |= (1 << 6);  // DEST_DREQ
+
+		cb->SOURCE_AD = BusAddress(axfer->srcaddr);
+		cb->DEST_AD = periphaddr;
+	}
+	else // PER -> MEM
+	{
+		if ((axfer->flags & DMATR_NO_DST_INC) == 0)  tinfo |= DMA_CB_TI_DEST_INC;
+		tinfo |= (1 << 10);  // SRC_DREQ
+
+		cb->SOURCE_AD = periphaddr;
+		cb->DEST_AD = BusAddress(axfer->dstaddr);
+	}
+
+	cb->TI = tinfo;
+	cb->TXFR_LEN = len;
+	cb->STRIDE = 0;
+
+	tdmode = false;
+
+	SetNextCb(axfer);
+	return true;
+}
+
+bool THwDmaChannel_broadcom::PrepareTransferDma4(THwDmaTransfer * axfer)
+{
+	TDma4ControlBlock * cb4 = (TDma4ControlBlock *)cb;
+
+	uint64_t srcaddr;
+	uint64_t dstaddr;
+	uint32_t tinfo = DMA4_TI_WAIT_RESP;
+	uint32_t srci = 0;
+	uint32_t desti = 0;
+
+	if (axfer->flags & DMATR_MEM_TO_MEM)
+	{
+		unsigned len = axfer->count * axfer->bytewidth;
+
+		srcaddr = PhysAddress(axfer->srcaddr);
+		dstaddr = PhysAddress(axfer->dstaddr);
+
+		if ((axfer->flags & DMATR_NO_SRC_INC) == 0)  srci |= DMA4_XI_INC;
+		if ((axfer->flags & DMATR_NO_DST_INC) == 0)  desti |= DMA4_XI_INC;
+
+		unsigned burst = (DMAXFER_AUTO == axfer->burstlength ? 8 : axfer->burstlength);
+		srci  |= DMA4_XI_BURST_LENGTH(burst);
+		desti |= DMA4_XI_BURST_LENGTH(burst);
+
+		unsigned bw = MemBusWidth(axfer, srcaddr, dstaddr, len);
+		if (16 == bw)
+		{
+			srci  |= DMA4_XI_SIZE_128;
+			desti |= DMA4_XI_SIZE_128;
+		}
+		else if (8 == bw)
+		{
+			srci  |= DMA4_XI_SIZE_64;
+			desti |= DMA4_XI_SIZE_64;
+		}
+
+		cb4->LEN = len;
+		tdmode = false;
+	}
+	else
+	{
+		// the same 2D method like on the normal channels: one item per row,
+		// the memory address is advanced with the stride
+
+		tinfo |= (DMA4_TI_TDMODE | DMA4_TI_PERMAP(dmarq));
+
+		if (DMAXFER_AUTO != axfer->burstlength)
+		{
+			srci  |= DMA4_XI_BURST_LENGTH(axfer->burstlength);
+			desti |= DMA4_XI_BURST_LENGTH(axfer->burstlength);
+		}
+
+		if (istx)  // MEM -> PER
+		{
+			if ((axfer->flags & DMATR_NO_SRC_INC) == 0)  srci |= DMA4_XI_STRIDE(axfer->bytewidth);
+			tinfo |= DMA4_TI_D_DREQ;
+			srcaddr = PhysAddress(axfer->srcaddr);
+			dstaddr = (uint64_t(DMA4_PERIPH_ADDR_HI) << 32) | periphaddr;
+		}
+		else // PER -> MEM
+		{
+			if ((axfer->flags & DMATR_NO_DST_INC) == 0)  desti |= DMA4_XI_STRIDE(axfer->bytewidth);
+			tinfo |= DMA4_TI_S_DREQ;
+			srcaddr = (uint64_t(DMA4_PERIPH_ADDR_HI) << 32) | periphaddr;
+			dstaddr = PhysAddress(axfer->dstaddr);
+		}
+
+		cb4->LEN = (((axfer->count-1) << 16) | axfer->bytewidth);
+		tdmode = true;
+		rowlength = axfer->bytewidth;
+	}
+
+	if (DMAXFER_AUTO != axfer->waits)
+	{
+		tinfo |= (DMA4_TI_S_WAITS(axfer->waits) | DMA4_TI_D_WAITS(axfer->waits));
+	}
+
+	cb4->TI = tinfo;
+	cb4->SRC = uint32_t(srcaddr);
+	cb4->SRCI = (srci | DMA4_XI_ADDR_HI(srcaddr >> 32));
+	cb4->DEST = uint32_t(dstaddr);
+	cb4->DESTI = (desti | DMA4_XI_ADDR_HI(dstaddr >> 32));
+
+	uint32_t cbaddr4 = uint32_t(PhysAddress(cb) >> 5);
+	cb4->NEXT_CB = ((axfer->flags & DMATR_CIRCULAR) ? cbaddr4 : 0);  // loop back to self
+
+	regs4->CB = cbaddr4;
+	return true;
+}
+
+bool THwDmaChannel_broadcom::Prepare2DTransfer(THwDmaTransfer * axfer)
+{
+	if ((DMA_CHTYPE_LITE == chtype) || (0 == axfer->xlength) || (0 == axfer->ycount))
+	{
+		printf("DMA%i: unsupported 2D transfer\n", chnum);
+		return false;
+	}
+
+	bool memtomem = (0 != (axfer->flags & DMATR_MEM_TO_MEM));
+	bool srcmem = (memtomem || istx);
+	bool dstmem = (memtomem || !istx);
+	bool srcinc = (srcmem && ((axfer->flags & DMATR_NO_SRC_INC) == 0));
+	bool dstinc = (dstmem && ((axfer->flags & DMATR_NO_DST_INC) == 0));
+	int  srcstride = (srcmem ? axfer->srcstride : 0);
+	int  dststride = (dstmem ? axfer->dststride : 0);
+
+	unsigned txlen = (DMA_CB_TXFR_LEN_YLENGTH(axfer->ycount) | DMA_CB_TXFR_LEN_XLENGTH(axfer->xlength));
+
+	tdmode = true;
+	rowlength = axfer->xlength;
+
+	if (DMA_CHTYPE_DMA4 == chtype)
+	{
+		TDma4ControlBlock * cb4 = (TDma4ControlBlock *)cb;
+		uint64_t periphaddr4 = ((uint64_t(DMA4_PERIPH_ADDR_HI) << 32) | periphaddr);
+		uint64_t srcaddr = (srcmem ? PhysAddress(axfer->srcaddr) : periphaddr4);
+		uint64_t dstaddr = (dstmem ? PhysAddress(axfer->dstaddr) : periphaddr4);
+
+		uint32_t tinfo = (DMA4_TI_WAIT_RESP | DMA4_TI_TDMODE);
+		if (!memtomem)
+		{
+			tinfo |= (DMA4_TI_PERMAP(dmarq) | (istx ? DMA4_TI_D_DREQ : DMA4_TI_S_DREQ));
+		}
+		if (DMAXFER_AUTO != axfer->waits)
+		{
+			tinfo |= (DMA4_TI_S_WAITS(axfer->waits) | DMA4_TI_D_WAITS(axfer->waits));
+		}
+
+		uint32_t srci = DMA4_XI_STRIDE(srcstride);
+		uint32_t desti = DMA4_XI_STRIDE(dststride);
+		if (srcinc)  srci |= DMA4_XI_INC;
+		if (dstinc)  desti |= DMA4_XI_INC;
+		if (DMAXFER_AUTO != axfer->burstlength)
+		{
+			srci  |= DMA4_XI_BURST_LENGTH(axfer->burstlength);
+			desti |= DMA4_XI_BURST_LENGTH(axfer->burstlength);
+		}
+
+		cb4->TI = tinfo;
+		cb4->SRC = uint32_t(srcaddr);
+		cb4->SRCI = (srci | DMA4_XI_ADDR_HI(srcaddr >> 32));
+		cb4->DEST = uint32_t(dstaddr);
+		cb4->DESTI = (desti | DMA4_XI_ADDR_HI(dstaddr >> 32));
+		cb4->LEN = txlen;
+
+		uint32_t cbaddr4 = uint32_t(PhysAddress(cb) >> 5);
+		cb4->NEXT_CB = ((axfer->flags & DMATR_CIRCULAR) ? cbaddr4 : 0);  // loop back to self
+
+		regs4->CB = cbaddr4;
+		return true;
+	}
+
+	uint32_t tinfo = (BurstTiBits(axfer, memtomem) | DMA_CB_TI_WAIT_RESP | DMA_CB_TI_TDMODE);
+	if (!memtomem)
+	{
+		tinfo |= ((dmarq << 16) | (istx ? (1 << 6) : (1 << 10)));  // PERMAP + DEST_DREQ / SRC_DREQ
+	}
+	if (srcinc)  tinfo |= DMA_CB_TI_SRC_INC;
+	if (dstinc)  tinfo |= DMA_CB_TI_DEST_INC;
+
+	cb->TI = tinfo;
+	cb->SOURCE_AD = (srcmem ? BusAddress(axfer->srcaddr) : periphaddr);
+	cb->DEST_AD = (dstmem ? BusAddress(axfer->dstaddr) : periphaddr);
+	cb->TXFR_LEN = txlen;
+	cb->STRIDE = (DMA_CB_STRIDE_D_STRIDE(dststride) | DMA_CB_STRIDE_S_STRIDE(srcstride));
+
+	SetNextCb(axfer);
+	return true;
+}
+
+uint32_t THwDmaChannel_broadcom::BurstTiBits(THwDmaTransfer * axfer, bool amemtomem)
+{
+	// defaults: the peripherals get single accesses as their FIFOs are gated by the DREQ,
+	// memory copies use long and wide bursts
+	unsigned burst = axfer->burstlength;
+	unsigned waits = axfer->waits;
+	unsigned wide  = axfer->widebursts;
+
+	if (DMAXFER_AUTO == burst)  burst = (amemtomem ? (DMA_CHTYPE_LITE == chtype ? 4 : 8) : 0);
+	if (DMAXFER_AUTO == waits)  waits = 0;
+	if (DMAXFER_AUTO == wide)   wide = (amemtomem ? 1 : 0);
+
+	if (DMA_CHTYPE_LITE == chtype)
+	{
+		wide = 0;  // not supported
+	}
+
+	return (DMA_CB_TI_BURST_LENGTH(burst) | DMA_CB_TI_WAITS(waits) | (wide ? 0 : DMA_CB_TI_NO_WIDE_BURSTS));
+}
+
+unsigned THwDmaChannel_broadcom::MemBusWidth(THwDmaTransfer * axfer, uint64_t asrcaddr, uint64_t adstaddr, unsigned alen)
+{
+	unsigned maxwidth = 16;
+	if (DMA_CHTYPE_LITE == chtype)  maxwidth = 4;
+
+	unsigned width = axfer->buswidth;
+	if ((DMAXFER_AUTO == width) || (width > maxwidth))
+	{
+		width = maxwidth;
+	}
+
+	// the largest width that suits to the alignment
+	while ((width > 4) && ((asrcaddr | adstaddr | alen) & (width - 1)))
+	{
+		width >>= 1;
+	}
+
+	if ((8 == width) && (DMA_CHTYPE_DMA4 != chtype))
+	{
+		width = 4;  // only 32 or 128 bit on the normal channels
+	}
+
+	return width;
 }
 
 unsigned THwDmaChannel_broadcom::Remaining()
 {
-	unsigned txfr_len = regs->TXFR_LEN;
-	unsigned bw = (txfr_len & 0xFFFF);
-	unsigned cnt = (txfr_len >> 16);
-  return (bw * cnt + bw);
+	return DecodeRemaining(regs4 ? regs4->LEN : regs->TXFR_LEN);
+}
+
+void THwDmaChannel_broadcom::GetProgress(THwDmaProgress * rprog)
+{
+	// consistent snapshot: the length must belong to the same control block load.
+	// The circular transfer reloads the same self-linked CB, so the CONBLK_AD does
+	// not change at the wrap, but the remaining length grows then.
+	uint32_t cbaddr;
+	uint32_t txfr_len;
+	uint32_t txfr_len_before;
+	do
+	{
+		cbaddr = regs->CONBLK_AD;  // CB on the DMA4
+		txfr_len_before = (regs4 ? regs4->LEN : regs->TXFR_LEN);
+		txfr_len = (regs4 ? regs4->LEN : regs->TXFR_LEN);
+	}
+	while ((cbaddr != regs->CONBLK_AD) || (DecodeRemaining(txfr_len) > DecodeRemaining(txfr_len_before)));
+
+	unsigned remaining = 0;
+	if (cbaddr)  // zero when the end of the chain was reached
+	{
+		remaining = DecodeRemaining(txfr_len);
+		if (remaining > xfer_length)  remaining = xfer_length;
+	}
+
+	unsigned pos = xfer_length - remaining;
+	if (xfer_circular)
+	{
+		if (pos < prog_lastpos)
+		{
+			++prog_laps;
+		}
+		prog_lastpos = pos;
+	}
+
+	rprog->laps = prog_laps;
+	rprog->position = pos;
+	rprog->remaining = remaining;
+	rprog->bytes_done = uint64_t(prog_laps) * xfer_length + pos;
+	rprog->finished = (xfer_started && !xfer_circular && (0 == remaining) && !Active());
+}
+
+unsigned THwDmaChannel_broadcom::DecodeRemaining(uint32_t txfr_len)
+{
+	if (!tdmode)
+	{
+		return (txfr_len & 0x3FFFFFFF);
+	}
+
+	unsigned xlen = (txfr_len & 0xFFFF);  // remaining bytes of the current row
+	unsigned cnt = ((txfr_len >> 16) & 0x3FFF);
+  return (rowlength * cnt + xlen);
 }
@@ -32,23 +32,53 @@
 #define HWDMA_PRE_ONLY
 #include "hwdma.h"
 
-#define MAX_DMA_CHANNELS   7  // normal DMA channels only
+#define MAX_DMA_CHANNELS  15  // 0-6: normal, 7-10: Lite, 11-14: DMA4
+
+#define DMA_CHTYPE_NORMAL   0
+#define DMA_CHTYPE_LITE     1  // no 2D mode, no wide bursts, max. 65535 bytes
+#define DMA_CHTYPE_DMA4     2  // 40 bit addresses, different register and control block format
+
+#define DMA_LITE_MAX_LENGTH  65535
+
+#define DMA_CHMASK_NORMAL   0x007F
+#define DMA_CHMASK_LITE     0x0780
+#define DMA_CHMASK_DMA4     0x7800
+#define DMA_CHMASK_ALL      0x7FFF
+
+// The DMA4 sees the peripherals in the full 35 bit address map
+#define DMA4_PERIPH_ADDR_HI  0x04
 
 #define HWDMA_BUFFER_SIZE  4096 * 4  // 16k
+#define HWDMA_ARENA_STATE_FILE  "/run/nvhal_dma_arena"
+#define HWDMA_CACHED_BUFFER_SIZE  4096 * 16  // 64k
+#define HWDMA_CACHED_PAGE_SIZE    4096
+#define HWDMA_HUGE_BUFFER_SIZE    (4 * 1024 * 1024)  // default, see hwdma_init_huge_buffer()
+#define HWDMA_HUGE_PAGE_SIZE      (2 * 1024 * 1024)
+
+// the normal and Lite channels see only the first 1 GB of the RAM (0xC0000000 alias)
+#define HWDMA_LEGACY_PHYS_LIMIT   0x40000000ull
+#define HWDMA_DMA4_PHYS_LIMIT     (1ull << 35)
 
 // BCM2385 ARM Peripherals 4.2.1.2
 #define DMA_CB_TI_NO_WIDE_BURSTS (1<<26)
+#define DMA_CB_TI_WAITS(x)       (((x)&0x1f) << 21)
+#define DMA_CB_TI_BURST_LENGTH(x) (((x)&0xf) << 12)
+#define DMA_CB_TI_SRC_WIDTH      (1<<9)
 #define DMA_CB_TI_SRC_INC        (1<<8)
+#define DMA_CB_TI_DEST_WIDTH     (1<<5)
 #define DMA_CB_TI_DEST_INC       (1<<4)
+#define DMA_CB_TI_WAIT_RESP      (1<<3)
 #define DMA_CB_TI_TDMODE         (1<<1)
+#define DMA_CB_TI_INTEN          (1<<0)
 
 #define DMA_CS_RESET    (1<<31)
 #define DMA_CS_ABORT    (1<<30)
 #define DMA_CS_DISDEBUG (1<<28)
+#define DMA_CS_INT      (1<<2)
 #define DMA_CS_END      (1<<1)
 #define DMA_CS_ACTIVE   (1<<0)
 
-#define DMA_CB_TXFR_LEN_YLENGTH(y) (((y-1)&0x4fff) << 16)
+#define DMA_CB_TXFR_LEN_YLENGTH(y) (((y-1)&0x3fff) << 16)
 #define DMA_CB_TXFR_LEN_XLENGTH(x) ((x)&0xffff)
 #define DMA_CB_STRIDE_D_STRIDE(x)  (((x)&0xffff) << 16)
 #define DMA_CB_STRIDE_S_STRIDE(x)  ((x)&0xffff)
@@ -83,35 +113,132 @@ typedef struct
 //
 } TDmaControlBlock;  // 32 bytes
 
+// BCM2711 ARM Peripherals 4.5: DMA4 engines
+
+#define DMA4_TI_TDMODE           (1<<1)
+#define DMA4_TI_WAIT_RESP        (1<<2)
+#define DMA4_TI_PERMAP(x)        (((x)&0x1f) << 9)
+#define DMA4_TI_S_DREQ           (1<<14)
+#define DMA4_TI_D_DREQ           (1<<15)
+#define DMA4_TI_S_WAITS(x)       (((x)&0xff) << 16)
+#define DMA4_TI_D_WAITS(x)       (((x)&0xff) << 24)
+
+#define DMA4_XI_ADDR_HI(x)       ((x)&0xff)      // SRCI / DESTI bits
+#define DMA4_XI_BURST_LENGTH(x)  (((x)&0xf) << 8)
+#define DMA4_XI_INC              (1<<12)
+#define DMA4_XI_SIZE_64          (1<<13)
+#define DMA4_XI_SIZE_128         (2<<13)
+#define DMA4_XI_STRIDE(x)        (((x)&0xffff) << 16)
+
+#define DMA4_DEBUG_RESET         (1<<23)
+
+typedef struct
+{
+	volatile uint32_t   CS;           // Control and Status
+	volatile uint32_t   CB;           // Control Block Address >> 5
+	         uint32_t   _res08;
+	volatile uint32_t   DEBUG;        // Debug
+	// these are loaded from the control block:
+	volatile uint32_t   TI;           // Transfer Information
+	volatile uint32_t   SRC;          // Source Address [31:0]
+	volatile uint32_t   SRCI;         // Source Address [39:32] + Source Information
+	volatile uint32_t   DEST;         // Destination Address [31:0]
+	volatile uint32_t   DESTI;        // Destination Address [39:32] + Destination Information
+	volatile uint32_t   LEN;          // Transfer Length
+	volatile uint32_t   NEXT_CB;      // Next Control Block Address >> 5
+	volatile uint32_t   DEBUG2;       // More Debug
+//
+} TDma4ChannelRegs;
+
+typedef struct
+{
+	volatile uint32_t   TI;           // Transfer Information
+	volatile uint32_t   SRC;          // Source Address [31:0]
+	volatile uint32_t   SRCI;         // Source Address [39:32] + Source Information
+	volatile uint32_t   DEST;         // Destination Address [31:0]
+	volatile uint32_t   DESTI;        // Destination Address [39:32] + Destination Information
+	volatile uint32_t   LEN;          // Transfer Length
+	volatile uint32_t   NEXT_CB;      // Next Control Block Address >> 5
+	volatile uint32_t   _reserved;
+//
+} TDma4ControlBlock;  // 32 bytes
+
 class THwDmaChannel_broadcom : public THwDmaChannel_pre
 {
 public:
 	int                  dmarq = -1;
+	int                  chtype = DMA_CHTYPE_NORMAL;
 
 	TDmaChannelRegs *    regs = nullptr;
 	TDmaControlBlock *   cb = nullptr;
+	TDma4ChannelRegs *   regs4 = nullptr;  // DMA4 channels only, same as regs
 
 	bool Init(int achnum, int admarq);
+	bool Alloc(unsigned achmask, int admarq);  // Init() with a free channel from the DMA_CHMASK_... set
+	void Release();
 
 	void Prepare(bool aistx, unsigned aperiphaddr);
-	inline void Enable() { regs->CS = (cs_reg_base | DMA_CS_ACTIVE); }
+	inline void Enable() { regs->CS = (cs_reg_base | DMA_CS_INT | DMA_CS_END | DMA_CS_ACTIVE); }  // clears INT and END
 
   inline void Disable() { regs->CS = (cs_reg_base); }  // remove the ACTIVE flag
 	inline bool Enabled() { return ((regs->CS & DMA_CS_ACTIVE) != 0); }
 	inline bool Active()  { return Enabled(); }
+	inline void AckIrq()  { regs->CS = (cs_reg_base | DMA_CS_INT | (regs->CS & DMA_CS_ACTIVE)); }  // clears INT, keeps a circular one running
 	unsigned Remaining();
 
-	void PrepareTransfer(THwDmaTransfer * axfer);
-	inline void StartPreparedTransfer()              { Enable(); }
+	// the circular laps are counted at the wrap, call it at least once per lap
+	void GetProgress(THwDmaProgress * rprog);
+
+	bool PrepareTransfer(THwDmaTransfer * axfer);  // false = unsupported transfer, the channel can not be started
+	bool StartPreparedTransfer();
+	void FinishTransfer();  // invalidates the cached destination, called by Wait() and Service()
 
 protected:
 	unsigned    cs_reg_base = 0;
+	uint8_t *   cached_dst = nullptr;  // destination range in the cached DMA memory
+	unsigned    cached_dst_len = 0;
+	bool        tdmode = true;  // TXFR_LEN is in 2D format
+	unsigned    rowlength = 1;  // XLENGTH in 2D mode
+
+	bool        addr_error = false;  // a buffer address was not reachable during the PrepareTransfer()
+
+	unsigned BusAddress(void * aaddr);   // hwdma_bus_address(), sets the addr_error
+	uint64_t PhysAddress(void * aaddr);  // hwdma_phys_address(), sets the addr_error
+	bool PreparePeriphTransfer(THwDmaTransfer * axfer);
+	bool PrepareMemTransfer(THwDmaTransfer * axfer);
+	bool PrepareTransferLite(THwDmaTransfer * axfer);
+	bool PrepareTransferDma4(THwDmaTransfer * axfer);
+	bool Prepare2DTransfer(THwDmaTransfer * axfer);
+	void SetNextCb(THwDmaTransfer * axfer);
+	unsigned DecodeRemaining(uint32_t atxfrlen);
+	uint32_t BurstTiBits(THwDmaTransfer * axfer, bool amemtomem);
+	unsigned MemBusWidth(THwDmaTransfer * axfer, uint64_t asrcaddr, uint64_t adstaddr, unsigned alen);
+	void MaintainCaches(THwDmaTransfer * axfer);
 
 };
 
 #define HWDMACHANNEL_IMPL  THwDmaChannel_broadcom
 
 uint8_t * hwdma_allocate_dma_buffer(unsigned asize);  // allocates uncached DMA buffer
-unsigned hwdma_bus_address(void * aaddr);
+bool      hwdma_cleanup_dma_arena();  // frees the recorded VPU arena when no running process uses it
+uint8_t * hwdma_allocate_cached_buffer(unsigned asize);  // cached, max. one page, falls back to uncached
+bool      hwdma_init_huge_buffer(unsigned asize);         // optional, before the first hugepage allocation
+uint8_t * hwdma_allocate_huge_buffer(unsigned asize, int achtype = DMA_CHTYPE_NORMAL);  // cached, contiguous, nullptr on failure
+unsigned hwdma_bus_address(void * aaddr);   // address for the normal and Lite channels, 0 = not reachable
+uint64_t hwdma_phys_address(void * aaddr);  // address for the DMA4 channels, 0 = not a DMA buffer
+bool     hwdma_phys_usable(uint64_t aphys, unsigned alen, int achtype);  // in the reach of the channel type
+int      hwdma_channel_type(int achnum);
+
+// cache maintenance for the cached DMA memory (AArch64 only, no operation otherwise)
+void     hwdma_cache_clean(void * aaddr, unsigned alen);       // before the DMA reads
+void     hwdma_cache_invalidate(void * aaddr, unsigned alen);  // before the CPU reads what the DMA wrote
+bool     hwdma_is_cached(void * aaddr);
+
+// channel allocation, the channels used by the VPU and the Linux kernel are excluded
+unsigned hwdma_usable_channels();     // firmware mask without the channels in use by the kernel
+int      hwdma_alloc_channel(unsigned achmask, void * aowner);  // returns -1 when no free channel
+bool     hwdma_claim_channel(int achnum, void * aowner);
+void     hwdma_release_channel(int achnum, void * aowner);
+void     hwdma_release_all_channels();  // stops and releases the channels of this process
 
 #endif // def HWDMA_BROADCOM_H_
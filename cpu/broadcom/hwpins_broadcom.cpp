@@ -29,13 +29,35 @@
 #include "platform.h"
 #include "hwpins.h"
 #include "hw_utils.h"
+#include "hw_broker.h"
+#include "hwtrace.h"
 
 #include "stdio.h"
-#include "stddef.h"
 
 #define MAX_PORT_NUMBER   1
 #define MAX_PIN_NUMBER   57
 
+// The GPFSEL and PUP_PDN_CNTRL_REG words are shared by 10 and 16 pins, their
+// read-modify-write is protected by a spinlock per register. These only hold
+// for a few instructions, so an uncontended change costs one atomic exchange.
+// The locks are process-local: a concurrent PinSetup() from an other process on
+// a pin of the same register word is still unprotected (test/hwpins_stress.cpp).
+
+static uint8_t  g_gpfsel_lock[7] = {0};
+static uint8_t  g_pupdn_lock[4] = {0};
+
+static inline void hwpins_modify_reg(volatile uint32_t * areg, uint8_t * alock, uint32_t amask, uint32_t avalue)
+{
+	while (__atomic_test_and_set(alock, __ATOMIC_ACQUIRE))
+	{
+		// spin
+	}
+
+	*areg = ((*areg & ~amask) | avalue);
+
+	__atomic_clear(alock, __ATOMIC_RELEASE);
+}
+
 THwGpioRegs * THwPinCtrl_broadcom::GetGpioRegs(int aportnum)
 {
 	if (!regs)
@@ -59,7 +81,13 @@ bool THwPinCtrl_broadcom::PinSetup(int aportnum, int apinnum, unsigned flags)
 		return false;
 	}
 
-  unsigned tmp;
+	if (!hwres_claim(HWRES_GPIO_PIN, apinnum))
+	{
+		printf("GPIO%i is used by process %i\n", apinnum, hwres_owner(HWRES_GPIO_PIN, apinnum));
+		return false;
+	}
+
+  HWTRACE(HWTR_PIN_SETUP, apinnum, flags);
 
   unsigned regidx1 = (apinnum >> 5);
   unsigned regshift1 = (apinnum & 31);
@@ -95,12 +123,7 @@ bool THwPinCtrl_broadcom::PinSetup(int aportnum, int apinnum, unsigned flags)
   	sel = 0;
   }
 
-  printf("offsetof(GPFSEL) = %i\n", offsetof(THwGpioRegs, GPFSEL));
-
-  tmp = regs->GPFSEL[regidx3];
-  tmp &= ~(7 << regshift3);
-  tmp |= (sel << regshift3);
-  regs->GPFSEL[regidx3] = tmp;
+  hwpins_modify_reg(&regs->GPFSEL[regidx3], &g_gpfsel_lock[regidx3], (7 << regshift3), (sel << regshift3));
 
   // Set pullup / pulldown
   if (flags & PINCFG_PULLUP)
@@ -116,10 +139,7 @@ bool THwPinCtrl_broadcom::PinSetup(int aportnum, int apinnum, unsigned flags)
   	sel = 0;
   }
 
-  tmp = regs->PUP_PDN_CNTRL_REG[regidx2];
-  tmp &= ~(3 << regshift2);
-  tmp |= (sel << regshift2);
-  regs->PUP_PDN_CNTRL_REG[regidx2] = tmp;
+  hwpins_modify_reg(&regs->PUP_PDN_CNTRL_REG[regidx2], &g_pupdn_lock[regidx2], (3 << regshift2), (sel << regshift2));
 
   return true;
 }
@@ -218,10 +238,6 @@ void TGpioPin_broadcom::SwitchDirection(int adirection)
   unsigned regidx3 = (pinnum / 10);
   unsigned regshift3 = ((pinnum % 10) * 3);
 
-  unsigned tmp;
-  tmp = regs->GPFSEL[regidx3];
-  tmp &= ~(7 << regshift3);
-  tmp |= (sel << regshift3);
-  regs->GPFSEL[regidx3] = tmp;
+  hwpins_modify_reg(&regs->GPFSEL[regidx3], &g_gpfsel_lock[regidx3], (7 << regshift3), (sel << regshift3));
 }
 
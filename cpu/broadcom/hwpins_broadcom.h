@@ -32,6 +32,15 @@
 #define HWPINS_PRE_ONLY
 #include "hwpins.h"
 
+// The Broadcom GPFSEL encoding is used with PINCFG_AF_x: GPFSEL = 2 + x
+// These are the aliases for the alternate functions named in the documentation:
+#define PINCFG_AF_ALT0     PINCFG_AF_2
+#define PINCFG_AF_ALT1     PINCFG_AF_3
+#define PINCFG_AF_ALT2     PINCFG_AF_4
+#define PINCFG_AF_ALT3     PINCFG_AF_5
+#define PINCFG_AF_ALT4     PINCFG_AF_1
+#define PINCFG_AF_ALT5     PINCFG_AF_0
+
 struct THwGpioRegs  // gpio register definition for the BCM2711
 {
 	volatile uint32_t   GPFSEL[7];   // 00..18, index 6 is invalid!
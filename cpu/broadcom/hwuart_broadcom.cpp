@@ -31,7 +31,10 @@
 #include "string.h"
 
 #include "hwuart.h"
+#include "hwpins.h"
 #include "hw_utils.h"
+#include "hw_broker.h"
+#include "broadcom_utils.h"
 
 #define HWUART_MAX   6
 
@@ -39,6 +42,14 @@ uint8_t * g_hwuart_base_mem = nullptr;
 
 const uintptr_t hwuart_dev_offsets[6] = {0x000, 0xFFFF, 0x400, 0x600, 0x800, 0xA00};
 
+// CTS / RTS pins (the TX/RX pins are set up by the application)
+const uint8_t   hwuart_cts_pins[6] = {16, 0xFF,  2,  6, 10, 14};
+const uint8_t   hwuart_rts_pins[6] = {17, 0xFF,  3,  7, 11, 15};
+const unsigned  hwuart_flowctrl_af[6] =
+{
+	PINCFG_AF_ALT3, 0, PINCFG_AF_ALT4, PINCFG_AF_ALT4, PINCFG_AF_ALT4, PINCFG_AF_ALT4
+};
+
 bool THwUart_broadcom::Init(int adevnum)  // devnum: 0, 2, 3, 4, 5 , (UART1 is mini-uart, not supported here yet)
 {
 	devnum = adevnum;
@@ -57,11 +68,18 @@ bool THwUart_broadcom::Init(int adevnum)  // devnum: 0, 2, 3, 4, 5 , (UART1 is m
 		return false;
 	}
 
+	if (!hwres_claim(HWRES_UART, devnum))
+	{
+		printf("UART%i is used by process %i\n", devnum, hwres_owner(HWRES_UART, devnum));
+		return false;
+	}
+
 	if (!g_hwuart_base_mem)
 	{
 		g_hwuart_base_mem = (uint8_t *)hw_memmap(HWUART_BASE_ADDRESS, 4096);
 		if (!g_hwuart_base_mem)
 		{
+			hwres_release(HWRES_UART, devnum);  // do not keep the claim of a failed init
 			return false;
 		}
 	}
@@ -73,7 +91,11 @@ bool THwUart_broadcom::Init(int adevnum)  // devnum: 0, 2, 3, 4, 5 , (UART1 is m
 	regs->CR = 0; // disable the uart
 
 	// set baudrate
-	unsigned baseclock = HWUART_BASE_CLOCK;
+	unsigned baseclock = broadcom_vpu_telemetry()->uart_clock;  // might be changed in the config.txt
+	if (!baseclock)
+	{
+		baseclock = HWUART_BASE_CLOCK;
+	}
 
 	// baudrate = baseclock / (16 * brdiv)
 	// the brdiv has a 6 bit fractional part, therefore is the multiplication with 64:
@@ -106,14 +128,34 @@ bool THwUart_broadcom::Init(int adevnum)  // devnum: 0, 2, 3, 4, 5 , (UART1 is m
 
 	regs->LCRH = lcrh;
 
-	regs->IFLS = 0;
+	if (hwflowctrl)
+	{
+		if (!SetupFlowCtrlPins())
+		{
+			hwres_release(HWRES_UART, devnum);
+			return false;
+		}
+
+		// The RTS is deasserted when the RX FIFO reaches the RX watermark.
+		// While the RX DMA is running the FIFO is drained and the RTS stays active,
+		// when the DMA transfer is finished (or not started yet) the peer is stopped
+		// at half FIFO so the remaining 16 bytes can absorb its TX pipeline.
+		regs->IFLS = (2 << 3);  // RXIFLSEL(3): 2 = 1/2
+	}
+	else
+	{
+		regs->IFLS = 0;
+	}
+
 	regs->IMSC = 0x000; // disable all interrupts
 	regs->ICR = 0x7FF; // clear all interrupts
 	regs->DMACR = 0;
 
+	unsigned flowctrl = (hwflowctrl ? 1 : 0);
+
 	regs->CR = 0
-		| (0  << 15)  // CTSEN
-		| (0  << 14)  // RTSEN
+		| (flowctrl << 15)  // CTSEN: 1 = transmit only when CTS is asserted
+		| (flowctrl << 14)  // RTSEN: 1 = RTS is controlled by the RX FIFO level
 		| (0  << 11)  // RTS
 		| (1  <<  9)  // RXE: 1 = receive enable
 		| (1  <<  8)  // TXE: 1 = transmit enable
@@ -126,11 +168,32 @@ bool THwUart_broadcom::Init(int adevnum)  // devnum: 0, 2, 3, 4, 5 , (UART1 is m
 	return true;
 }
 
+bool THwUart_broadcom::SetupFlowCtrlPins()
+{
+	unsigned cts_pin = hwuart_cts_pins[devnum];
+	unsigned rts_pin = hwuart_rts_pins[devnum];
+
+	if (0xFF == cts_pin)
+	{
+		return false;
+	}
+
+	unsigned af = hwuart_flowctrl_af[devnum];
+
+	if (!hwpinctrl.PinSetup(0, cts_pin, af | PINCFG_PULLUP))  // CTS with pull-up: unconnected = not ready
+	{
+		return false;
+	}
+
+	return hwpinctrl.PinSetup(0, rts_pin, af);
+}
+
 bool THwUart_broadcom::TrySendChar(char ach)
 {
 	if (0 == (regs->FR & (1 << 5)))  // Transmit FIFO not Full?
 	{
 		regs->DR = ach;
+		++stats.bytes_out;
 		return true;
 	}
 	else
@@ -143,13 +206,55 @@ bool THwUart_broadcom::TryRecvChar(char * ach)
 {
 	if (regs->FR & (1 << 4)) // receive FIFO empty ?
 	{
+		rxburst = 0;
 		return false;
 	}
-	else
+
+	uint32_t dr = regs->DR;
+	*ach = dr;
+
+	++stats.bytes_in;
+	if (rxburst < 32)  // FIFO depth
+	{
+		++rxburst;
+		if (rxburst > stats.rxfifo_hwm)  stats.rxfifo_hwm = rxburst;
+	}
+
+	if (dr & 0xF00)  // OE, BE, PE, FE
+	{
+		CountRxErrors(dr >> 8);
+	}
+
+	return true;
+}
+
+void THwUart_broadcom::CountRxErrors(uint32_t aerrbits)
+{
+	if (aerrbits & 1)  ++stats.framing_errors;
+	if (aerrbits & 2)  ++stats.parity_errors;
+	if (aerrbits & 4)  ++stats.breaks;
+	if (aerrbits & 8)  ++stats.overruns;
+}
+
+void THwUart_broadcom::CheckLineStatus()
+{
+	uint32_t rsr = regs->RSRECR;
+	if (rsr & 0xF)
 	{
-		*ach = regs->DR;
+		regs->RSRECR = 0; // clear the error flags
+		CountRxErrors(rsr);
+	}
+}
+
+bool THwUart_broadcom::RecvTimeout()
+{
+	if (regs->RIS & (1 << 6))  // RTRIS: receive timeout
+	{
+		regs->ICR = (1 << 6);
 		return true;
 	}
+
+	return false;
 }
 
 void THwUart_broadcom::DmaAssign(bool istx, THwDmaChannel * admach)
@@ -164,6 +269,10 @@ void THwUart_broadcom::DmaAssign(bool istx, THwDmaChannel * admach)
 	}
 
 	admach->Prepare(istx, dr_dma_address);
+
+	// the expected speed for the THwDmaChannel::Wait()
+	unsigned charbits = 1 + databits + (parity ? 1 : 0) + ((halfstopbits + 1) >> 1);
+	admach->xfer_rate = baudrate / charbits;
 }
 
 
@@ -176,7 +285,15 @@ bool THwUart_broadcom::DmaStartSend(THwDmaTransfer * axfer)
 
 	regs->DMACR |= (1 << 1); // enable TX DMA
 
-	txdma->StartTransfer(axfer);
+	if (!txdma->StartTransfer(axfer))
+	{
+		regs->DMACR &= ~(1 << 1);
+		return false;
+	}
+
+	stats.bytes_out += axfer->count * axfer->bytewidth;
+	++stats.dma_tx_starts;
+	HWTRACE(HWTR_UART_DMA_TX, devnum, axfer->count * axfer->bytewidth);
 
 	return true;
 }
@@ -188,10 +305,24 @@ bool THwUart_broadcom::DmaStartRecv(THwDmaTransfer * axfer)
 		return false;
 	}
 
+	rxdma_length = axfer->count * axfer->bytewidth;
+	HWTRACE(HWTR_UART_DMA_RX, devnum, rxdma_length);
+	rxdma_circular = (0 != (axfer->flags & DMATR_CIRCULAR));
+	rxidle_lastpos = 0;
+	rxidle_packetpos = 0;
+	rxidle_lastchange = CLOCKCNT;
+	regs->ICR = (1 << 6);  // clear the receive timeout
+
 	regs->DMACR |= (1 << 0); // enable RX DMA
 
-	rxdma->StartTransfer(axfer);
+	if (!rxdma->StartTransfer(axfer))
+	{
+		regs->DMACR &= ~(1 << 0);
+		rxdma_length = 0;
+		return false;
+	}
 
+	++stats.dma_rx_starts;
 	return true;
 }
 
@@ -65,10 +65,15 @@ public:
 
 	bool Init(int adevnum);
 
+	bool SetupFlowCtrlPins();
+
 	bool TrySendChar(char ach);
 	bool TryRecvChar(char * ach);
 
-	inline bool SendFinished()   { return (0 != (regs->FR & (1 << 3))); }  // UART BUSY?
+	inline bool SendFinished()   { return (0 == (regs->FR & (1 << 3))); }  // UART not BUSY
+
+	bool RecvTimeout();  // checks and clears the receive timeout status
+	void CheckLineStatus();  // collects the receive errors of the DMA transfers into the stats
 
 	void DmaAssign(bool istx, THwDmaChannel * admach);
 
@@ -77,6 +82,9 @@ public:
 
 public:
 	THwUartRegs *      regs = nullptr;
+
+protected:
+	void CountRxErrors(uint32_t aerrbits);  // bit0: FE, bit1: PE, bit2: BE, bit3: OE
 };
 
 #define HWUART_IMPL THwUart_broadcom
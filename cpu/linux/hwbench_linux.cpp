@@ -0,0 +1,143 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVHAL project: https://github.com/nvitya/nvhal
+ * Copyright (c) 2020 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwbench_linux.cpp
+ *  brief:    Linux host specific benchmarks
+ *  version:  1.00
+ *  date:     2026-10-19
+ *  authors:  nvitya
+ *  notes:
+ *    The UART is measured over a pseudo-terminal loopback, the DMA send uses
+ *    the software channel. There is no simulated mode here, the host is real.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "hwbench.h"
+#include "hwuart.h"
+#include "hwdma.h"
+
+static int hwbench_open_pty(int * rslave)
+{
+	int master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if ((master < 0) || (grantpt(master) != 0) || (unlockpt(master) != 0))
+	{
+		if (master >= 0)  close(master);
+		return -1;
+	}
+
+	*rslave = open(ptsname(master), O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (*rslave < 0)
+	{
+		close(master);
+		return -1;
+	}
+
+	return master;
+}
+
+static void hwbench_drain(int afd)
+{
+	uint8_t buf[4096];
+	while (read(afd, &buf[0], sizeof(buf)) > 0)
+	{
+		// discard
+	}
+}
+
+bool THwBench::RunPlatform()
+{
+	double t0, t1;
+
+	if (simulated)
+	{
+		return false;  // there are no RAM register sets here
+	}
+
+	int slave;
+	int master = hwbench_open_pty(&slave);
+	if (master < 0)
+	{
+		return true;
+	}
+
+	THwUart uart;
+	if (uart.InitFd(slave))
+	{
+		const unsigned charcnt = 10000;
+		t0 = NowNs();
+		for (unsigned n = 0; n < charcnt; ++n)
+		{
+			while (!uart.TrySendChar('U'))
+			{
+				hwbench_drain(master);
+			}
+		}
+		t1 = NowNs();
+		Add("uart_sendchar", (double(charcnt) * 1e9) / (t1 - t0), "char/s", charcnt);
+		hwbench_drain(master);
+
+		const unsigned printcnt = 1000;
+		t0 = NowNs();
+		for (unsigned n = 0; n < printcnt; ++n)
+		{
+			uart.printf("bench %u\r\n", n);
+			hwbench_drain(master);
+		}
+		t1 = NowNs();
+		Add("uart_printf", (t1 - t0) / printcnt / 1000.0, "us", printcnt);
+
+		THwDmaChannel dma;
+		uint8_t * txbuf = hwdma_allocate_dma_buffer(4096);
+		if (txbuf && dma.Init(0))
+		{
+			uart.DmaAssign(true, &dma);
+
+			THwDmaTransfer xfer;
+			xfer.srcaddr = txbuf;
+			xfer.bytewidth = 1;
+			xfer.count = 4096;
+
+			const unsigned xfercnt = 100;
+			t0 = NowNs();
+			for (unsigned n = 0; n < xfercnt; ++n)
+			{
+				uart.DmaStartSend(&xfer);
+				while (dma.Active())
+				{
+					hwbench_drain(master);
+				}
+			}
+			t1 = NowNs();
+			Add("uart_dma_send", (double(xfer.count) * xfercnt * 1000.0) / (t1 - t0), "MB/s", xfercnt);
+			free(txbuf);
+		}
+	}
+
+	close(slave);
+	close(master);
+
+	return true;
+}
@@ -0,0 +1,179 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVHAL project: https://github.com/nvitya/nvhal
+ * Copyright (c) 2020 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwdma_linux.cpp
+ *  brief:    Software emulated DMA channels for the Linux host
+ *  version:  1.00
+ *  date:     2026-10-19
+ *  authors:  nvitya
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "hwdma.h"
+
+uint8_t * hwdma_allocate_dma_buffer(unsigned asize)
+{
+	asize = ((asize + 31) & 0xFFFFFFE0);  // 32 byte granularity
+	return (uint8_t *)aligned_alloc(32, asize);
+}
+
+bool THwDmaChannel_linux::Init(int achnum)
+{
+	initialized = false;
+	chnum = achnum;
+	running = false;
+	initialized = true;
+	return true;
+}
+
+void THwDmaChannel_linux::Prepare(bool aistx, unsigned aperiphaddr)
+{
+	istx = aistx;
+	periphaddr = aperiphaddr;
+}
+
+bool THwDmaChannel_linux::PrepareTransfer(THwDmaTransfer * axfer)
+{
+	running = false;
+	position = 0;
+	prog_laps = 0;
+	prog_lastpos = 0;
+	xfer_started = false;
+	xfer_circular = (0 != (axfer->flags & DMATR_CIRCULAR));
+
+	if (axfer->flags & DMATR_MEM_TO_MEM)
+	{
+		MemCopy(axfer);  // finished at the start
+		xfer_length = 0;
+		memaddr = nullptr;
+		xfer_prepared = true;
+		return true;
+	}
+
+	// the 2D and the non-incrementing memory modes are not emulated
+	xfer_length = axfer->count * axfer->bytewidth;
+	memaddr = (uint8_t *)(istx ? axfer->srcaddr : axfer->dstaddr);
+	xfer_prepared = true;
+	return true;
+}
+
+void THwDmaChannel_linux::MemCopy(THwDmaTransfer * axfer)
+{
+	uint8_t * src = (uint8_t *)axfer->srcaddr;
+	uint8_t * dst = (uint8_t *)axfer->dstaddr;
+
+	if (axfer->flags & DMATR_2D)
+	{
+		for (unsigned y = 0; y < axfer->ycount; ++y)
+		{
+			memmove(dst, src, axfer->xlength);
+			src += axfer->xlength + axfer->srcstride;
+			dst += axfer->xlength + axfer->dststride;
+		}
+	}
+	else
+	{
+		memmove(dst, src, axfer->count * axfer->bytewidth);
+	}
+}
+
+bool THwDmaChannel_linux::StartPreparedTransfer()
+{
+	if (!xfer_prepared)
+	{
+		return false;
+	}
+
+	xfer_started = true;
+	running = (xfer_length > 0);
+	Pump();
+	return true;
+}
+
+void THwDmaChannel_linux::Pump()
+{
+	if (!running || (fd < 0))
+	{
+		return;
+	}
+
+	while (true)
+	{
+		// the circular transfers continue at the beginning in the same call
+		struct iovec iov[2];
+		int iovcnt = 1;
+		iov[0].iov_base = memaddr + position;
+		iov[0].iov_len = xfer_length - position;
+		if (xfer_circular && position)
+		{
+			iov[1].iov_base = memaddr;
+			iov[1].iov_len = position;
+			iovcnt = 2;
+		}
+
+		ssize_t r = (istx ? writev(fd, &iov[0], iovcnt) : readv(fd, &iov[0], iovcnt));
+		if (r <= 0)
+		{
+			return;  // no more data / space now
+		}
+
+		position += r;
+		if (position >= xfer_length)
+		{
+			if (!xfer_circular)
+			{
+				position = xfer_length;
+				running = false;
+				return;
+			}
+
+			position -= xfer_length;
+			++prog_laps;
+		}
+	}
+}
+
+bool THwDmaChannel_linux::Active()
+{
+	Pump();
+	return running;
+}
+
+unsigned THwDmaChannel_linux::Remaining()
+{
+	Pump();
+	return xfer_length - position;
+}
+
+void THwDmaChannel_linux::GetProgress(THwDmaProgress * rprog)
+{
+	Pump();
+	rprog->laps = prog_laps;
+	rprog->position = position;
+	rprog->remaining = xfer_length - position;
+	rprog->bytes_done = uint64_t(prog_laps) * xfer_length + position;
+	rprog->finished = (xfer_started && !running);
+}
@@ -0,0 +1,74 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVHAL project: https://github.com/nvitya/nvhal
+ * Copyright (c) 2020 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwdma_linux.h
+ *  brief:    Software emulated DMA channels for the Linux host
+ *  version:  1.00
+ *  date:     2026-10-19
+ *  authors:  nvitya
+ *  notes:
+ *    A channel moves the data between a memory buffer and a file descriptor
+ *    (assigned by the UART DmaAssign()), the I/O is pumped in the Active() and
+ *    Remaining() calls with non-blocking readv() / writev(). Memory to memory
+ *    transfers are done at the start.
+*/
+
+#ifndef HWDMA_LINUX_H_
+#define HWDMA_LINUX_H_
+
+#define HWDMA_PRE_ONLY
+#include "hwdma.h"
+
+class THwDmaChannel_linux : public THwDmaChannel_pre
+{
+public:
+	int          fd = -1;  // the peripheral side
+
+	bool Init(int achnum);
+
+	void Prepare(bool aistx, unsigned aperiphaddr);
+	inline void Enable()  { running = true; }
+	inline void Disable() { running = false; }
+	inline bool Enabled() { return running; }
+	bool Active();
+	unsigned Remaining();
+
+	void GetProgress(THwDmaProgress * rprog);
+
+	bool PrepareTransfer(THwDmaTransfer * axfer);
+	bool StartPreparedTransfer();
+	inline void FinishTransfer() { }
+	inline void AckIrq() { }
+
+protected:
+	bool         running = false;
+	uint8_t *    memaddr = nullptr;
+	unsigned     position = 0;  // in the current lap
+
+	void Pump();
+	void MemCopy(THwDmaTransfer * axfer);
+};
+
+#define HWDMACHANNEL_IMPL  THwDmaChannel_linux
+
+uint8_t * hwdma_allocate_dma_buffer(unsigned asize);  // normal memory on the host
+
+#endif // def HWDMA_LINUX_H_
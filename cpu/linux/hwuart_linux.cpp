@@ -0,0 +1,348 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVHAL project: https://github.com/nvitya/nvhal
+ * Copyright (c) 2020 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwuart_linux.cpp
+ *  brief:    UART over a Linux tty file descriptor
+ *  version:  1.00
+ *  date:     2026-10-19
+ *  authors:  nvitya
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <linux/serial.h>
+
+#include "hwuart.h"
+
+struct THwUartBaudSpeed
+{
+	int       baudrate;
+	speed_t   speed;
+};
+
+static const THwUartBaudSpeed hwuart_speeds[] =
+{
+	{    1200, B1200 },    {    2400, B2400 },    {    4800, B4800 },
+	{    9600, B9600 },    {   19200, B19200 },   {   38400, B38400 },
+	{   57600, B57600 },   {  115200, B115200 },  {  230400, B230400 },
+	{  460800, B460800 },  {  500000, B500000 },  {  576000, B576000 },
+	{  921600, B921600 },  { 1000000, B1000000 }, { 1500000, B1500000 },
+	{ 2000000, B2000000 }, { 3000000, B3000000 }, { 4000000, B4000000 },
+	{ 0, 0 }
+};
+
+bool THwUart_linux::Init(int adevnum)
+{
+	devnum = adevnum;
+	initialized = false;
+
+	char fname[64];
+	if (devname)
+	{
+		snprintf(fname, sizeof(fname), "%s", devname);
+	}
+	else
+	{
+		snprintf(fname, sizeof(fname), "/dev/ttyS%i", adevnum);
+	}
+
+	int f = open(fname, O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (f < 0)
+	{
+		printf("UART: error opening \"%s\"\n", fname);
+		return false;
+	}
+
+	if (!InitFd(f))
+	{
+		close(f);
+		fd = -1;
+		return false;
+	}
+
+	return true;
+}
+
+bool THwUart_linux::InitFd(int afd)
+{
+	initialized = false;
+
+	if (epfd >= 0)
+	{
+		close(epfd);
+		epfd = -1;
+	}
+
+	if ((fd >= 0) && (fd != afd))
+	{
+		close(fd);  // re-init
+	}
+
+	fd = afd;
+	txerrno = 0;
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+	if (isatty(fd) && !SetupTermios())
+	{
+		return false;
+	}
+
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (epfd >= 0)
+	{
+		struct epoll_event ev = {};
+		ev.events = EPOLLIN;
+		ev.data.fd = fd;
+		epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+		epevents = EPOLLIN;
+	}
+
+	rxbuf_pos = 0;
+	rxbuf_len = 0;
+	memset(&icount[0], 0, sizeof(icount));
+
+	initialized = true;
+	return true;
+}
+
+bool THwUart_linux::SetupTermios()
+{
+	struct termios tio;
+	if (tcgetattr(fd, &tio) != 0)
+	{
+		return false;
+	}
+
+	cfmakeraw(&tio);
+
+	const THwUartBaudSpeed * bs = &hwuart_speeds[0];
+	while (bs->baudrate && (bs->baudrate != baudrate))
+	{
+		++bs;
+	}
+
+	if (!bs->baudrate)
+	{
+		printf("UART: unsupported baudrate %i\n", baudrate);
+		return false;
+	}
+
+	cfsetispeed(&tio, bs->speed);
+	cfsetospeed(&tio, bs->speed);
+
+	tio.c_cflag &= ~(CSIZE | PARENB | PARODD | CSTOPB | CRTSCTS);
+	tio.c_cflag |= (CLOCAL | CREAD);
+
+	if (databits > 8)  databits = 8;
+	if (databits < 5)  databits = 5;
+	const tcflag_t csizes[4] = {CS5, CS6, CS7, CS8};
+	tio.c_cflag |= csizes[databits - 5];
+
+	if (parity)
+	{
+		tio.c_cflag |= PARENB;
+		if (oddparity)  tio.c_cflag |= PARODD;
+	}
+
+	if (halfstopbits >= 3)
+	{
+		tio.c_cflag |= CSTOPB;
+	}
+
+	if (hwflowctrl)
+	{
+		tio.c_cflag |= CRTSCTS;
+	}
+
+	tio.c_cc[VMIN] = 0;
+	tio.c_cc[VTIME] = 0;
+
+	if (tcsetattr(fd, TCSANOW, &tio) != 0)
+	{
+		printf("UART: error setting the line parameters\n");
+		return false;
+	}
+
+	tcflush(fd, TCIOFLUSH);
+	return true;
+}
+
+bool THwUart_linux::TrySendChar(char ach)
+{
+	if (write(fd, &ach, 1) != 1)
+	{
+		if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+		{
+			return false;  // the output buffer of the driver is full
+		}
+
+		// e.g. EIO when the pty peer was closed: drop the char, SendChar() must not wait forever
+		txerrno = errno;
+		++tx_dropped;
+		return true;
+	}
+
+	++stats.bytes_out;
+	return true;
+}
+
+bool THwUart_linux::TryRecvChar(char * ach)
+{
+	if (rxbuf_pos >= rxbuf_len)
+	{
+		// read in chunks, not with one system call per character
+		ssize_t r = read(fd, &rxbuf[0], sizeof(rxbuf));
+		if (r <= 0)
+		{
+			return false;
+		}
+
+		rxbuf_pos = 0;
+		rxbuf_len = r;
+		stats.bytes_in += r;
+		if (unsigned(r) > stats.rxfifo_hwm)  stats.rxfifo_hwm = r;
+	}
+
+	*ach = rxbuf[rxbuf_pos++];
+	return true;
+}
+
+bool THwUart_linux::SendFinished()
+{
+	int outq = 0;
+	if (ioctl(fd, TIOCOUTQ, &outq) != 0)
+	{
+		return true;
+	}
+	return (outq == 0);
+}
+
+void THwUart_linux::CheckLineStatus()
+{
+	struct serial_icounter_struct ic;
+	if (ioctl(fd, TIOCGICOUNT, &ic) != 0)
+	{
+		return;
+	}
+
+	stats.framing_errors += ic.frame - icount[0];
+	stats.parity_errors += ic.parity - icount[1];
+	stats.breaks += ic.brk - icount[2];
+	stats.overruns += (ic.overrun + ic.buf_overrun) - icount[3];
+
+	icount[0] = ic.frame;
+	icount[1] = ic.parity;
+	icount[2] = ic.brk;
+	icount[3] = ic.overrun + ic.buf_overrun;
+}
+
+bool THwUart_linux::WaitReady(bool arecv, unsigned atimeout_us)
+{
+	if (arecv && (rxbuf_pos < rxbuf_len))
+	{
+		return true;
+	}
+
+	if (epfd < 0)
+	{
+		return false;
+	}
+
+	unsigned events = (arecv ? EPOLLIN : EPOLLOUT);
+	if (events != epevents)
+	{
+		struct epoll_event ev = {};
+		ev.events = events;
+		ev.data.fd = fd;
+		epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev);
+		epevents = events;
+	}
+
+	struct epoll_event ev;
+	return (epoll_wait(epfd, &ev, 1, (atimeout_us + 999) / 1000) > 0);
+}
+
+void THwUart_linux::DmaAssign(bool istx, THwDmaChannel * admach)
+{
+	if (istx)
+	{
+		txdma = admach;
+	}
+	else
+	{
+		rxdma = admach;
+	}
+
+	admach->fd = fd;
+	admach->Prepare(istx, 0);
+
+	unsigned charbits = 1 + databits + (parity ? 1 : 0) + (halfstopbits + 1) / 2;
+	admach->xfer_rate = baudrate / charbits;
+}
+
+bool THwUart_linux::DmaStartSend(THwDmaTransfer * axfer)
+{
+	if (!txdma || !axfer)
+	{
+		return false;
+	}
+
+	if (!txdma->StartTransfer(axfer))
+	{
+		return false;
+	}
+
+	stats.bytes_out += axfer->count * axfer->bytewidth;
+	++stats.dma_tx_starts;
+	HWTRACE(HWTR_UART_DMA_TX, devnum, axfer->count * axfer->bytewidth);
+
+	return true;
+}
+
+bool THwUart_linux::DmaStartRecv(THwDmaTransfer * axfer)
+{
+	if (!rxdma || !axfer)
+	{
+		return false;
+	}
+
+	rxdma_length = axfer->count * axfer->bytewidth;
+	HWTRACE(HWTR_UART_DMA_RX, devnum, rxdma_length);
+	rxdma_circular = (0 != (axfer->flags & DMATR_CIRCULAR));
+	rxidle_lastpos = 0;
+	rxidle_packetpos = 0;
+	rxidle_lastchange = CLOCKCNT;
+
+	if (!rxdma->StartTransfer(axfer))
+	{
+		rxdma_length = 0;
+		return false;
+	}
+
+	++stats.dma_rx_starts;
+	return true;
+}
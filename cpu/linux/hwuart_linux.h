@@ -0,0 +1,80 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVHAL project: https://github.com/nvitya/nvhal
+ * Copyright (c) 2020 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwuart_linux.h
+ *  brief:    UART over a Linux tty file descriptor
+ *  version:  1.00
+ *  date:     2026-10-19
+ *  authors:  nvitya
+ *  notes:
+ *    Init(devnum) opens the /dev/ttyS<devnum> unless the devname is set,
+ *    InitFd() takes an already opened tty, e.g. the slave side of a pty.
+*/
+
+#ifndef HWUART_LINUX_H_
+#define HWUART_LINUX_H_
+
+#define HWUART_PRE_ONLY
+#include "hwuart.h"
+
+#define HWUART_RXBUF_SIZE  256
+
+class THwUart_linux : public THwUart_pre
+{
+public:
+	int          fd = -1;
+	const char * devname = nullptr;  // overrides the /dev/ttyS<devnum>
+	int          txerrno = 0;        // errno of the last failed write, other than EAGAIN
+	uint32_t     tx_dropped = 0;     // chars dropped because of write errors
+
+	bool Init(int adevnum);
+	bool InitFd(int afd);
+
+	bool TrySendChar(char ach);
+	bool TryRecvChar(char * ach);
+
+	bool SendFinished();
+
+	inline bool RecvTimeout()  { return false; }  // the idle detection uses the DMA position
+	void CheckLineStatus();  // the error counters of the serial driver, not available on ptys
+
+	void DmaAssign(bool istx, THwDmaChannel * admach);
+
+	bool DmaStartSend(THwDmaTransfer * axfer);
+	bool DmaStartRecv(THwDmaTransfer * axfer);
+
+	// waits with epoll until the tty is readable (arecv) or writable, false = timeout
+	bool WaitReady(bool arecv, unsigned atimeout_us);
+
+protected:
+	int          epfd = -1;
+	unsigned     epevents = 0;
+	uint8_t      rxbuf[HWUART_RXBUF_SIZE];
+	unsigned     rxbuf_pos = 0;
+	unsigned     rxbuf_len = 0;
+	int          icount[4] = {0};  // frame, parity, brk, overrun
+
+	bool SetupTermios();
+};
+
+#define HWUART_IMPL THwUart_linux
+
+#endif // def HWUART_LINUX_H_
@@ -0,0 +1,92 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVHAL project: https://github.com/nvitya/nvhal
+ * Copyright (c) 2020 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwdma_pagemap.cpp
+ *  brief:    Pagemap translation and DMA reach checks of the cached / hugepage buffers
+ *  version:  1.00
+ *  date:     2026-10-19
+ *  authors:  nvitya
+ *  notes:
+ *    Uses synthetic pagemap entries, so it runs on any host without root. Build
+ *    it together with the core and cpu/broadcom sources, the include path needs
+ *    a board.h like the applications.
+*/
+
+#include <stdio.h>
+
+#include "platform.h"
+#include "hw_utils.h"
+#include "hwdma.h"
+
+#define PM_PRESENT  (1ull << 63)
+
+static unsigned g_errors = 0;
+
+static void check(bool acond, const char * adesc)
+{
+	if (!acond)
+	{
+		printf("FAILED: %s\n", adesc);
+		++g_errors;
+	}
+}
+
+// physical address of a page as the buffer allocation sees it
+static uint64_t page_phys(uint64_t apfn, uintptr_t avaddr)
+{
+	return hw_pagemap_entry_to_phys(PM_PRESENT | apfn, avaddr, 4096);
+}
+
+int main()
+{
+	// translation
+
+	check(0x12345000 == page_phys(0x12345, 0x7F0000000000), "pfn to physical address");
+	check(0x12345ABC == page_phys(0x12345, 0x7F0000000ABC), "offset in the page is kept");
+	check(0 == hw_pagemap_entry_to_phys(0x12345, 0x7F0000000000, 4096), "not present page");
+	check(0 == hw_pagemap_entry_to_phys(PM_PRESENT, 0x7F0000000000, 4096), "hidden pfn (no CAP_SYS_ADMIN)");
+	check(0x123450000ull == hw_pagemap_entry_to_phys(PM_PRESENT | 0x12345, 0x7F0000000000, 0x10000), "64k system pages");
+	check(0x200000000ull == page_phys(0x200000, 0x7F0000000000), "page above 4 GB");
+
+	// reach of the channel types: 4k page
+
+	uint64_t low = page_phys(0x3FFFE, 0);   // last but one page below 1 GB
+	uint64_t high = page_phys(0x40000, 0);  // first page at 1 GB
+	check(hwdma_phys_usable(low, 4096, DMA_CHTYPE_NORMAL), "4k page below 1 GB, normal channel");
+	check(hwdma_phys_usable(low, 8192, DMA_CHTYPE_LITE), "range ending at 1 GB, Lite channel");
+	check(!hwdma_phys_usable(low, 8193, DMA_CHTYPE_NORMAL), "range crossing 1 GB, normal channel");
+	check(!hwdma_phys_usable(high, 32, DMA_CHTYPE_NORMAL), "4k page at 1 GB, normal channel");
+	check(!hwdma_phys_usable(high, 32, DMA_CHTYPE_LITE), "4k page at 1 GB, Lite channel");
+	check(hwdma_phys_usable(high, 32, DMA_CHTYPE_DMA4), "4k page at 1 GB, DMA4 channel");
+
+	// 2 MB hugepages, typically placed high in the RAM by the kernel
+
+	uint64_t huge_low = page_phys(0x3FE00, 0);   // 1 GB - 2 MB
+	uint64_t huge_high = page_phys(0xFFE00, 0);  // 4 GB - 2 MB
+	check(hwdma_phys_usable(huge_low, HWDMA_HUGE_PAGE_SIZE, DMA_CHTYPE_NORMAL), "hugepage below 1 GB, normal channel");
+	check(!hwdma_phys_usable(huge_high, HWDMA_HUGE_PAGE_SIZE, DMA_CHTYPE_NORMAL), "hugepage below 4 GB, normal channel");
+	check(!hwdma_phys_usable(huge_high, HWDMA_HUGE_PAGE_SIZE, DMA_CHTYPE_LITE), "hugepage below 4 GB, Lite channel");
+	check(hwdma_phys_usable(huge_high, HWDMA_HUGE_PAGE_SIZE, DMA_CHTYPE_DMA4), "hugepage below 4 GB, DMA4 channel");
+	check(hwdma_phys_usable(page_phys(0x1FFE00, 0), HWDMA_HUGE_PAGE_SIZE, DMA_CHTYPE_DMA4), "hugepage below 8 GB, DMA4 channel");
+
+	printf("hwdma_pagemap: %s\n", (g_errors ? "FAILED" : "OK"));
+	return (g_errors ? 1 : 0);
+}
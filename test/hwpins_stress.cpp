@@ -0,0 +1,135 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVHAL project: https://github.com/nvitya/nvhal
+ * Copyright (c) 2020 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwpins_stress.cpp
+ *  brief:    Concurrent PinSetup() on the pins of shared GPFSEL / PUP_PDN words
+ *  version:  1.00
+ *  date:     2026-10-19
+ *  authors:  nvitya
+ *  notes:
+ *    The pin controller works on a RAM register set, so it runs on any host. Build
+ *    it with -pthread together with the core and cpu/broadcom sources, the include
+ *    path needs a board.h like the applications.
+ *    GPIO0..GPIO9 share GPFSEL0 and PUP_PDN_CNTRL_REG0, every thread changes one
+ *    of them back and forth and leaves it in a pin specific state. A lost
+ *    read-modify-write shows up as a wrong field at the end of a round.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "platform.h"
+#include "hwpins.h"
+#include "hw_broker.h"
+
+#define STRESS_THREADS   10
+#define STRESS_ROUNDS    50
+#define STRESS_CHANGES   2000
+
+static THwGpioRegs         g_ramregs;
+static pthread_barrier_t   g_barrier;
+
+static unsigned stress_final_flags(int apin)
+{
+	if (apin & 1)
+	{
+		return PINCFG_AF_3 | PINCFG_PULLDOWN;  // FSEL = 5, PUP_PDN = 2
+	}
+	else
+	{
+		return PINCFG_OUTPUT | PINCFG_PULLUP;  // FSEL = 1, PUP_PDN = 1
+	}
+}
+
+static void * stress_thread(void * aarg)
+{
+	int pin = (int)(intptr_t)aarg;
+
+	for (unsigned r = 0; r < STRESS_ROUNDS; ++r)
+	{
+		pthread_barrier_wait(&g_barrier);  // start together
+
+		for (unsigned n = 0; n < STRESS_CHANGES; ++n)
+		{
+			hwpinctrl.PinSetup(0, pin, PINCFG_INPUT);
+			hwpinctrl.PinSetup(0, pin, stress_final_flags(pin));
+		}
+
+		pthread_barrier_wait(&g_barrier);  // round done
+		pthread_barrier_wait(&g_barrier);  // checked
+	}
+
+	return nullptr;
+}
+
+int main()
+{
+	memset(&g_ramregs, 0, sizeof(g_ramregs));
+	hwpinctrl.regs = &g_ramregs;
+	hwres_bypass(true);
+
+	pthread_barrier_init(&g_barrier, nullptr, STRESS_THREADS + 1);
+
+	pthread_t threads[STRESS_THREADS];
+	for (int i = 0; i < STRESS_THREADS; ++i)
+	{
+		pthread_create(&threads[i], nullptr, stress_thread, (void *)(intptr_t)i);
+	}
+
+	unsigned errors = 0;
+	for (unsigned r = 0; r < STRESS_ROUNDS; ++r)
+	{
+		pthread_barrier_wait(&g_barrier);
+		pthread_barrier_wait(&g_barrier);
+
+		uint32_t fsel = g_ramregs.GPFSEL[0];
+		uint32_t pupdn = g_ramregs.PUP_PDN_CNTRL_REG[0];
+		for (int pin = 0; pin < STRESS_THREADS; ++pin)
+		{
+			unsigned expfsel = ((pin & 1) ? 5 : 1);
+			unsigned exppull = ((pin & 1) ? 2 : 1);
+			unsigned gotfsel = ((fsel >> (pin * 3)) & 7);
+			unsigned gotpull = ((pupdn >> (pin * 2)) & 3);
+			if ((gotfsel != expfsel) || (gotpull != exppull))
+			{
+				printf("round %u GPIO%i: FSEL=%u (expected %u), PUP_PDN=%u (expected %u)\n",
+						r, pin, gotfsel, expfsel, gotpull, exppull);
+				++errors;
+			}
+		}
+
+		g_ramregs.GPFSEL[0] = 0;
+		g_ramregs.PUP_PDN_CNTRL_REG[0] = 0;
+
+		pthread_barrier_wait(&g_barrier);
+	}
+
+	for (int i = 0; i < STRESS_THREADS; ++i)
+	{
+		pthread_join(threads[i], nullptr);
+	}
+
+	pthread_barrier_destroy(&g_barrier);
+
+	printf("hwpins_stress: %u threads, %u rounds: %s\n", STRESS_THREADS, STRESS_ROUNDS, (errors ? "FAILED" : "OK"));
+	return (errors ? 1 : 0);
+}